@@ -0,0 +1,17 @@
+Import("env")
+
+import glob
+import os
+import sys
+
+# The SCons script has no `__file__`, the tools are found from the project.
+sys.path.insert(0, os.path.join(env.subst("$PROJECT_DIR"), "font-tools"))
+from subset_fonts import build
+
+# The fonts of the Adafruit GFX library, installed as a dependency of GxEPD2.
+library_fonts = glob.glob(os.path.join(env.subst("$PROJECT_LIBDEPS_DIR"), env.subst("$PIOENV"), "*", "Fonts", "FreeMonoBold9pt7b.h"))
+if not library_fonts:
+    sys.exit("Adafruit GFX fonts not found, install the dependencies first!")
+
+before, after = build(os.path.dirname(library_fonts[0]))
+print("Font subsets generated, bitmaps: %d -> %d bytes" % (before, after))
@@ -0,0 +1,156 @@
+"""
+Compresses the bitmaps of an Adafruit GFX font header with run-length encoding.
+
+Large fonts are mostly long horizontal runs, and rows repeating the one
+above, so they compress to about half of their size. The glyph table and
+the font structure keep the GFX format, with the bitmap offsets pointing
+into the compressed data, so the metrics can still be used by GFX.
+The glyphs are drawn by `displayPrintCompressed` in `display_helper.cpp`.
+
+Format of a glyph, row by row:
+    - A header byte with the high bit set repeats the last literal row
+      as many times as the low 7 bits say.
+    - Otherwise the header is the number of runs in the row, followed
+      by one byte per run. Runs alternate between white and black,
+      starting with white. Trailing white is left out.
+
+Usage:
+    python font-tools/compress_font.py src/display_helper/custom_fonts/FreeMonoBold48pt7b.h
+"""
+
+import io
+import os
+import re
+import sys
+
+
+# --- Parsing ---
+
+def read_font(path):
+    """Reads the name, bitmap, glyph table and font parameters of a GFX font header."""
+
+    with open(path) as file:
+        source = file.read()
+
+    name = re.search(r"const\s+GFXfont\s+(\w+)\s+PROGMEM", source).group(1)
+    bitmap_source, glyph_source = source.split("Glyphs[]", 1)
+    bitmap = bytes(int(value, 16) for value in re.findall(r"0x([0-9A-Fa-f]{2})", bitmap_source))
+    glyphs = [tuple(int(value) for value in match) for match in re.findall(
+        r"\{\s*(\d+),\s*(-?\d+),\s*(-?\d+),\s*(-?\d+),\s*(-?\d+),\s*(-?\d+)\s*\}", glyph_source)]
+    first, last, y_advance = re.search(
+        r"(0x[0-9A-Fa-f]+),\s*(0x[0-9A-Fa-f]+),\s*(\d+)\s*\};", glyph_source).groups()
+
+    return name, bitmap, glyphs, int(first, 16), int(last, 16), int(y_advance)
+
+
+def glyph_rows(bitmap, offset, width, height):
+    """Unpacks the rows of a glyph. GFX bitmaps are continuous, rows are not padded."""
+
+    bits = [(bitmap[offset + i // 8] >> (7 - i % 8)) & 1 for i in range(width * height)]
+    return [bits[row * width:(row + 1) * width] for row in range(height)]
+
+
+# --- Encoding ---
+
+def encode_row(row):
+    """Encodes a row as a run count, and the alternating white and black runs."""
+
+    runs = []
+    color, length = 0, 0
+    for bit in row:
+        if bit == color:
+            length += 1
+        else:
+            runs.append(length)
+            color, length = bit, 1
+    if color == 1:
+        runs.append(length)
+
+    assert len(runs) < 0x80 and all(run < 0x100 for run in runs), "Row is too wide to encode."
+    return [len(runs)] + runs
+
+
+def encode_glyph(rows):
+    """Encodes the rows of a glyph, repeated rows only take a header byte."""
+
+    data = []
+    previous, repeats = None, 0
+    for row in rows + [None]:
+        if row is not None and row == previous:
+            repeats += 1
+            continue
+        while repeats:
+            count = min(repeats, 0x7F)
+            data.append(0x80 | count)
+            repeats -= count
+        if row is not None:
+            data += encode_row(row)
+            previous = row
+    return data
+
+
+# --- Output ---
+
+def write_header(path, name, data, glyphs, first, last, y_advance, notes):
+    """Writes a font in the same layout as the GFX font headers. Unchanged files are not touched."""
+
+    characters = [chr(code) for code in range(first, last + 1)]
+    with io.StringIO() as file:
+        for note in notes:
+            file.write("// %s\n" % note)
+        file.write("\nconst uint8_t %sBitmaps[] PROGMEM = {\n" % name)
+        for i in range(0, len(data), 12):
+            line = ", ".join("0x%02X" % value for value in data[i:i + 12])
+            file.write("  %s%s\n" % (line, "," if i + 12 < len(data) else " };"))
+        file.write("\nconst GFXglyph %sGlyphs[] PROGMEM = {\n" % name)
+        for i, glyph in enumerate(glyphs):
+            end = " }; " if i == len(glyphs) - 1 else ",   "
+            file.write("  { %5d, %3d, %3d, %3d, %4d, %4d }%s// 0x%02X '%s'\n"
+                       % (glyph + (end, first + i, characters[i])))
+        file.write("\nconst GFXfont %s PROGMEM = {\n" % name)
+        file.write("  (uint8_t  *)%sBitmaps,\n" % name)
+        file.write("  (GFXglyph *)%sGlyphs,\n" % name)
+        file.write("  0x%02X, 0x%02X, %d };\n" % (first, last, y_advance))
+        content = file.getvalue()
+
+    if os.path.exists(path):
+        with open(path) as file:
+            if file.read() == content:
+                return
+    with open(path, "w") as file:
+        file.write(content)
+
+
+def compress(glyphs, bitmap):
+    """Compresses the bitmaps of the glyphs, returns the data and the new glyph table."""
+
+    data = []
+    compressed_glyphs = []
+    for offset, width, height, x_advance, x_offset, y_offset in glyphs:
+        compressed_glyphs.append((len(data), width, height, x_advance, x_offset, y_offset))
+        data += encode_glyph(glyph_rows(bitmap, offset, width, height))
+    return data, compressed_glyphs
+
+
+def main():
+
+    if len(sys.argv) != 2:
+        print(__doc__)
+        return 1
+
+    source_path = sys.argv[1]
+    name, bitmap, glyphs, first, last, y_advance = read_font(source_path)
+
+    data, compressed_glyphs = compress(glyphs, bitmap)
+
+    output_path = os.path.splitext(source_path)[0] + "Rle.h"
+    write_header(output_path, name + "Rle", data, compressed_glyphs, first, last, y_advance, [
+        "Generated by `font-tools/compress_font.py`, do not edit.",
+        "Run-length encoded, draw with `displayPrintCompressed`.",
+        "Bitmaps compressed from %d to %d bytes." % (len(bitmap), len(data)),
+    ])
+    print("%s: %d -> %d bytes" % (output_path, len(bitmap), len(data)))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
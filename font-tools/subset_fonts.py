@@ -0,0 +1,141 @@
+"""
+Generates font headers with only the glyphs the firmware can render.
+
+The source files are scanned for the strings that can reach the display:
+string literals on lines calling display and `clockFormat` functions, and the
+output of the `sprintf` and `strftime` formats used to fill the displayed buffers.
+Glyphs of other characters keep their advance, but lose their bitmap,
+and the range of the font is narrowed to the used characters.
+
+The headers are written to `src/display_helper/custom_fonts/generated`,
+with the same names as the original fonts. It is run before every build
+by `build_fonts.py`, but can also be run by hand:
+    python font-tools/subset_fonts.py <path to Adafruit GFX Library/Fonts>
+"""
+
+import glob
+import os
+import re
+import sys
+
+from compress_font import compress, glyph_rows, read_font, write_header
+
+
+# --- Paths ---
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCE_DIR = os.path.join(ROOT, "src")
+CUSTOM_FONT_DIR = os.path.join(SOURCE_DIR, "display_helper", "custom_fonts")
+OUTPUT_DIR = os.path.join(CUSTOM_FONT_DIR, "generated")
+
+# --- Fonts ---
+
+# Name, if it is from the library, and the fixed character set if the font has one.
+# The large font is only used for the time, and it is also compressed.
+FONTS = [
+    ("FreeMonoBold48pt7b", False, "0123456789:"),
+    ("FreeMonoBold24pt7b", True, None),
+    ("FreeMonoBold12pt7b", True, None),
+    ("FreeMonoBold9pt7b", True, None),
+]
+COMPRESSED_FONTS = ["FreeMonoBold48pt7b"]
+
+# Characters of numbers, always included.
+NUMBER_CHARACTERS = "0123456789-"
+
+
+# --- Scanning ---
+
+def expand_format(text):
+    """Replaces the conversions of a format string with the characters they can produce."""
+
+    text = text.replace("%%", "\0")
+    text = re.sub(r"%[-+ 0#]*\d*(\.\d+)?[a-zA-Z]", NUMBER_CHARACTERS, text)
+    return text.replace("\0", "%")
+
+
+def scan_characters():
+    """Collects every character the firmware can render."""
+
+    characters = set(NUMBER_CHARACTERS)
+    for path in glob.glob(os.path.join(SOURCE_DIR, "**", "*.cpp"), recursive=True):
+        with open(path) as file:
+            for line in file:
+                stripped = line.strip()
+                if stripped.startswith(("#", "//")) or "Serial" in line or "_output" in line:
+                    continue
+                literals = re.findall(r'"((?:[^"\\]|\\.)*)"', line)
+                if re.search(r"\bdisplay|\bclockFormat|printf\s*\(|strftime\s*\(", line):
+                    for literal in literals:
+                        characters.update(expand_format(literal))
+                elif re.search(r"\bchar\s+\w+\[\d*\]\s*=", line):
+                    for literal in literals:
+                        characters.update(literal)
+
+    return {character for character in characters if 0x20 <= ord(character) <= 0x7E}
+
+
+# --- Subsetting ---
+
+def subset(glyphs, bitmap, first, characters):
+    """Keeps the bitmaps of the used glyphs, and narrows the range to them."""
+
+    used = sorted(ord(character) for character in characters if first <= ord(character) < first + len(glyphs))
+    new_first, new_last = used[0], used[-1]
+
+    data = []
+    new_glyphs = []
+    for code in range(new_first, new_last + 1):
+        offset, width, height, x_advance, x_offset, y_offset = glyphs[code - first]
+        if chr(code) not in characters:
+            new_glyphs.append((0, 0, 0, x_advance, 0, 0))
+            continue
+        new_glyphs.append((len(data), width, height, x_advance, x_offset, y_offset))
+        data += bitmap[offset:offset + (width * height + 7) // 8]
+
+    return bytes(data), new_glyphs, new_first, new_last
+
+
+def build(library_font_dir):
+    """Writes the subset of every font. Returns the total size of the bitmaps before and after."""
+
+    characters = scan_characters()
+    os.makedirs(OUTPUT_DIR, exist_ok=True)
+    total_before, total_after = 0, 0
+
+    for font, from_library, fixed in FONTS:
+
+        source_dir = library_font_dir if from_library else CUSTOM_FONT_DIR
+        name, bitmap, glyphs, first, last, y_advance = read_font(os.path.join(source_dir, font + ".h"))
+        data, new_glyphs, new_first, new_last = subset(glyphs, bitmap, first, set(fixed) if fixed else characters)
+        notes = [
+            "Generated by `font-tools/subset_fonts.py`, do not edit.",
+            "Subset of %s with the characters: %s" % (name, "".join(chr(c) for c in range(new_first, new_last + 1)
+                                                            if new_glyphs[c - new_first][1] > 0)),
+        ]
+
+        if font in COMPRESSED_FONTS:
+            data, new_glyphs = compress(new_glyphs, data)
+            name += "Rle"
+            notes.append("Run-length encoded, draw with `displayPrintCompressed`.")
+
+        notes.append("Bitmaps reduced from %d to %d bytes." % (len(bitmap), len(data)))
+        write_header(os.path.join(OUTPUT_DIR, name + ".h"), name, data, new_glyphs,
+                     new_first, new_last, y_advance, notes)
+        total_before += len(bitmap)
+        total_after += len(data)
+
+    return total_before, total_after
+
+
+def main():
+
+    if len(sys.argv) != 2:
+        print(__doc__)
+        return 1
+
+    before, after = build(sys.argv[1])
+    print("Font bitmaps: %d -> %d bytes" % (before, after))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
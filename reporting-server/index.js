@@ -45,11 +45,11 @@ app.post("/report", async (req, res) => {
     try {
         await fs.access(targetFilePath);
     } catch {
-        await fs.writeFile(targetFilePath, "timestamp; bootNum; currentMode; batteryLevel; wifiStrength; syncDuration; timeShift; timeShiftAverage; timeShiftSamples; timeDeviation; timeDeviationAverage; timeDeviationSamples\n", "utf8");
+        await fs.writeFile(targetFilePath, "timestamp; bootNum; currentMode; batteryLevel; wifiStrength; syncDuration; timeShift; timeShiftAverage; timeShiftSamples; timeDeviation; timeDeviationAverage; timeDeviationSamples; stateOfCharge; daysRemaining; dailyCharge\n", "utf8");
     }
 
     // Append data to file.
-    await fs.appendFile(targetFilePath, `${timestamp}; ${data.bootNum}; ${data.currentMode}; ${data.batteryLevel}; ${data.wifiStrength}; ${data.syncDuration}; ${data.timeShift}; ${data.timeShiftAverage}; ${data.timeShiftSamples}; ${data.timeDeviation}; ${data.timeDeviationAverage}; ${data.timeDeviationSamples}\n`, "utf8");
+    await fs.appendFile(targetFilePath, `${timestamp}; ${data.bootNum}; ${data.currentMode}; ${data.batteryLevel}; ${data.wifiStrength}; ${data.syncDuration}; ${data.timeShift}; ${data.timeShiftAverage}; ${data.timeShiftSamples}; ${data.timeDeviation}; ${data.timeDeviationAverage}; ${data.timeDeviationSamples}; ${data.stateOfCharge}; ${data.daysRemaining}; ${data.dailyCharge}\n`, "utf8");
 
     // Send and OK response.
     res.sendStatus(200);
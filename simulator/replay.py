@@ -0,0 +1,718 @@
+"""
+Accelerated replay of the clock's boot logic, for tuning the settings.
+
+The firmware wakes up every minute, so the effect of options like
+FULL_REFRESH_EVERY, RESYNC_EVERY, OMIT_SLEEP or SLEEP_MARGIN only shows
+after weeks of running. This script replays the same decisions that
+`setup()` makes on a scripted timeline of button presses, charging,
+RTC drift and WiFi outages, and reports the cost of a month in a second.
+
+The settings are read from `src/settings.h`, and can be overridden with
+`-D NAME=VALUE`. The modes, their phases and the transition table are
+read from `src/boot_mode`, so the mode selection is the one of
+`bootModeSelect`. The timeline is a JSON file, see `month.json`.
+
+The durations and the light sleep current of the timeline are estimates,
+not measurements. Replace them with the fields of the boot profile, see
+BOOT_PROFILE in `settings.h`, before trusting the energy of a change.
+
+Usage:
+    python simulator/replay.py simulator/month.json -D RESYNC_EVERY=480
+"""
+
+import argparse
+import json
+import math
+import os
+import re
+import sys
+
+
+# --- Paths ---
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SETTINGS_PATH = os.path.join(ROOT, "src", "settings.h")
+CURVES_PATH = os.path.join(ROOT, "src", "battery_helper", "battery_curves.h")
+BOOT_MODE_HEADER_PATH = os.path.join(ROOT, "src", "boot_mode", "boot_mode.h")
+BOOT_MODE_SOURCE_PATH = os.path.join(ROOT, "src", "boot_mode", "boot_mode.cpp")
+CLOCK_FORMAT_PATH = os.path.join(ROOT, "src", "clock_format", "clock_format.h")
+DISPLAY_HELPER_PATH = os.path.join(ROOT, "src", "display_helper", "display_helper.cpp")
+
+# --- Display size, in the rotation of the clock face ---
+DISPLAY_WIDTH, DISPLAY_HEIGHT = 296, 128
+
+# --- Timeline defaults, estimates in milliseconds, see the boot profile fields ---
+DEFAULT_DURATIONS = {
+    "setup_ms": 60,             # Time spent in `setup()`, apart from the parts below.
+    "arduino_init_ms": 30,      # Time of `initArduino()`, skipped by FAST_BOOT. (`to_setup`)
+    "display_init_ms": 120,     # Full initialization of the display. (`display_init`)
+    "display_warm_init_ms": 5,  # Waking the display with WARM_DISPLAY_INIT. (`display_init` with `warm=1`)
+    "render_ms": 20,            # Rendering the clock face, skipped by RENDER_AHEAD. (`render`)
+    "full_refresh_ms": 2000,    # Duration of a full refresh.
+    "fast_refresh_ms": 600,     # Duration of a fast refresh of the whole screen.
+    "window_refresh_ms": 600,   # Duration of a partial refresh of a window.
+    "wifi_sync_ms": 2500,       # Time from turning on WiFi, to having the time synced. (`wifi`)
+}
+DEFAULT_LIGHT_SLEEP_UA = 130    # Light sleep current of the ESP32-C3 from its datasheet, not measured on the clock.
+DEFAULT_CHARGE_MA = 500         # Charging current of the battery.
+DEFAULT_UPDATE_MINUTES = 5      # Time in update mode, until the update button is pressed again.
+
+
+# --- Parsing ---
+
+def read_file(path):
+
+    with open(path) as file:
+        return file.read()
+
+
+def read_settings(overrides):
+    """Reads the defines in `settings.h`. Flags are True, numbers are ints."""
+
+    settings = {}
+    with open(SETTINGS_PATH) as file:
+        for line in file:
+            match = re.match(r"\s*#define\s+(\w+)\s*([^/\s][^/]*?)?\s*(//.*)?$", line)
+            if not match:
+                continue
+            name, value = match.group(1), (match.group(2) or "").strip()
+            try:
+                settings[name] = int(value, 0)
+            except ValueError:
+                settings[name] = value if value else True
+
+    for override in overrides:
+        name, _, value = override.partition("=")
+        settings[name] = int(value, 0) if value else True
+
+    return settings
+
+
+def read_curve(name):
+    """Reads the discharge curve selected by `BATTERY_CURVE`, as (millivolts, percent) pairs."""
+
+    body = re.search(name + r"\[\]\s*=\s*\{(.*?)\};", read_file(CURVES_PATH), re.S).group(1)
+    return [(int(mv), int(p)) for mv, p in re.findall(r"\{\s*(\d+)\s*,\s*(\d+)\s*\}", body)]
+
+
+def read_clock_areas():
+    """Reads the areas of the clock face fields from `display_helper.cpp`, in the order of their bits."""
+
+    body = re.search(r"display_clock_areas\[\w+\]\s*=\s*\{(.*?)\};", read_file(DISPLAY_HELPER_PATH), re.S).group(1)
+    return [tuple(int(v) for v in area) for area in re.findall(r"\{\s*(\d+),\s*(\d+),\s*(\d+),\s*(\d+)\s*\}", body)]
+
+
+def parse_time(event):
+    """Converts the `day` and `time` fields of an event to seconds from the start."""
+
+    hours, minutes, *seconds = (float(part) for part in event.get("time", "00:00").split(":"))
+    return event.get("day", 0) * 86400 + hours * 3600 + minutes * 60 + (seconds[0] if seconds else 0)
+
+
+def cdiv(a, b):
+    """Integer division truncating towards zero, like in C."""
+
+    quotient = abs(a) // abs(b)
+    return quotient if (a >= 0) == (b > 0) else -quotient
+
+
+# --- Boot Modes ---
+
+class BootModes:
+    """The modes, phases and transitions of `boot_mode.h` and `boot_mode.cpp`."""
+
+    def __init__(self):
+
+        header = read_file(BOOT_MODE_HEADER_PATH)
+        source = read_file(BOOT_MODE_SOURCE_PATH)
+
+        self.mode = {name: int(bits, 2) for name, bits in re.findall(r"#define\s+(\w+)_MODE\s+0b([01]+)", header)}
+        self.phase = {name: int(value, 16) for name, value in re.findall(r"#define\s+PHASE_(\w+)\s+(0x[0-9A-Fa-f]+)", header)}
+
+        wakes = re.search(r"enum\s+BootWake[^{]*\{(.*?)\};", header, re.S).group(1)
+        self.wake = {name: i for i, name in enumerate(re.findall(r"WAKE_(\w+)", wakes))}
+
+        table = re.search(r"boot_mode_phases\[\w+\]\s*=\s*\{(.*?)\};", header, re.S).group(1)
+        self.phases = {}
+        for name, value in re.findall(r"/\*\s*(\w+)\s*\*/\s*([^,]+),", table):
+            self.phases[self.mode[name]] = sum(self.phase[p] for p in re.findall(r"PHASE_(\w+)", value))
+
+        rows = re.search(r"boot_transitions\[\w+\]\s*=\s*\{(.*?)\};", source, re.S).group(1)
+        self.transitions = [(self.wake[wake], self.mode[mode], self.mode[blocked_by])
+                            for wake, mode, blocked_by in re.findall(r"\{\s*WAKE_(\w+),\s*(\w+)_MODE,\s*(\w+)_MODE\s*\}", rows)]
+
+        valid = re.search(r"desired_mode\s*&\s*\(([^)]*)\)", source).group(1)
+        self.valid_desired = sum(self.mode[name] for name in re.findall(r"(\w+)_MODE", valid))
+
+        runtime = re.search(r"#define\s+PHASES_NEED_RUNTIME\s+\(([^)]*)\)", header).group(1)
+        self.need_runtime = sum(self.phase[p] for p in re.findall(r"PHASE_(\w+)", runtime))
+
+    def phases_of(self, mode):
+        return self.phases.get(mode, 0)
+
+    def select(self, wakes, desired_mode, last_mode, charging_started, resync_due):
+        """Port of `bootModeSelect`, on the tables read from the sources."""
+
+        mode = self.mode["NULL"]
+        if desired_mode & self.valid_desired:
+            mode = desired_mode
+        else:
+            for wake, transition_mode, blocked_by in self.transitions:
+                if not wakes & (1 << wake):
+                    continue
+                if blocked_by != self.mode["NULL"] and last_mode == blocked_by:
+                    continue
+                mode = transition_mode
+                break
+
+        if charging_started and mode in (self.mode["NULL"], self.mode["NORMAL"]):
+            mode = self.mode["CHARGING"]
+        if mode == self.mode["NORMAL"] and resync_due:
+            mode = self.mode["RESYNC"]
+        if mode == self.mode["NULL"]:
+            mode = self.mode["RESET"]
+        return mode
+
+
+# --- Clock Face ---
+
+class ClockFace:
+    """The fields of the clock face, and the windows of `displaySetClockWindow`."""
+
+    def __init__(self):
+
+        self.field = {name: int(bits, 2) for name, bits in
+                      re.findall(r"#define\s+CLOCK_FIELD_(\w+)\s+0b([01]+)", read_file(CLOCK_FORMAT_PATH))}
+        self.areas = read_clock_areas()
+
+    def values(self, clock, battery_percent, charging, last_sync):
+        """The values of each field, at a time of the clock in seconds. The time zone is UTC."""
+
+        minute = math.floor(clock / 60)
+        return {
+            "HOUR": (minute // 60) % 24,
+            "MINUTE": minute % 60,
+            "DATE": minute // 1440,
+            "BATTERY": (battery_percent, charging),
+            "DAYS_REMAINING": None,
+            "LAST_SYNC": last_sync,
+        }
+
+    def changed(self, a, b):
+        """Like `clockChangedFields`, no values stand for a forgotten face."""
+
+        if a is None or b is None:
+            return self.field["ALL"]
+        return sum(self.field[name] for name in a if a[name] != b[name])
+
+    def window(self, fields):
+        """Grows the fields to the ones inside their window, like `displaySetClockWindow`."""
+
+        inside = fields
+        while True:
+            fields = inside
+            x1, y1, x2, y2 = DISPLAY_WIDTH, DISPLAY_HEIGHT, 0, 0
+            for i, (x, y, w, h) in enumerate(self.areas):
+                if fields & (1 << i):
+                    x1, y1, x2, y2 = min(x1, x), min(y1, y), max(x2, x + w), max(y2, y + h)
+            inside = 0
+            for i, (x, y, w, h) in enumerate(self.areas):
+                if x < x2 and x + w > x1 and y < y2 and y + h > y1:
+                    inside |= 1 << i
+            if inside == fields:
+                return inside
+
+
+# --- Simulation ---
+
+class Replay:
+
+    def __init__(self, settings, timeline):
+
+        self.s = settings
+        self.d = dict(DEFAULT_DURATIONS, **timeline.get("durations", {}))
+        self.curve = read_curve(settings["BATTERY_CURVE"])
+        self.modes = BootModes()
+        self.face = ClockFace()
+        self.m = self.modes.mode
+        self.p = self.modes.phase
+        self.end = timeline.get("days", 30) * 86400
+        self.light_sleep_ua = timeline.get("light_sleep_ua", DEFAULT_LIGHT_SLEEP_UA)
+        self.charge_ma = timeline.get("charge_ma", DEFAULT_CHARGE_MA)
+
+        # Buttons and drift changes are applied in order, outages and charges are looked up.
+        events = sorted(timeline.get("events", []), key=parse_time)
+        self.buttons = [(parse_time(e), e) for e in events if "button" in e]
+        self.drifts = [(parse_time(e), e["drift_ppm"]) for e in events if "drift_ppm" in e]
+        self.outages = [(parse_time(e), parse_time(e) + e["wifi_outage_minutes"] * 60)
+                        for e in events if "wifi_outage_minutes" in e]
+        self.charges = [(parse_time(e), parse_time(e) + e["charge_minutes"] * 60)
+                        for e in events if "charge_minutes" in e]
+
+        # True time, and the clock's error compared to it, in seconds.
+        self.t = 0.0
+        self.error = 0.0
+        self.drift_ppm = timeline.get("drift_ppm", 0)
+
+        # Persistent state, as in `rtc_state.h`. A power on fails the check of the state.
+        self.boot_num = 0
+        self.mode = self.m["NULL"]
+        self.desired_mode = self.m["RESET"]
+        self.charging = False
+        self.shift_average = 0
+        self.shift_samples = 0
+        self.correction_step = 0
+        self.battery_percent = 0
+        self.last_sync = None
+
+        # The display, kept in deep sleep.
+        self.hibernated = False
+        self.face_shown = None      # The values on the display, None after `clockForget`.
+        self.ahead = None           # The values and fields drawn ahead, see `renderAhead`.
+
+        # Battery, with the capacity in microcoulombs.
+        self.capacity = timeline.get("battery_mah", settings["BATTERY_CAPACITY"]) * 3600000
+        self.used = 0.0
+        self.charged = 0.0
+
+        # Results.
+        self.refreshes = {"full": 0, "fast": 0, "window": 0}
+        self.radio_seconds = 0.0
+        self.awake_seconds = 0.0
+        self.light_sleep_seconds = 0.0
+        self.boots = 0
+        self.fast_boots = 0
+        self.warm_inits = 0
+        self.renders = 0
+        self.renders_ahead = 0
+        self.switches = 0
+        self.presses_lost = 0
+        self.syncs = 0
+        self.updates = 0
+        self.charge_starts = 0
+        self.shown = None          # The minute on the display, or None if the clock is not shown.
+        self.shown_since = 0.0
+        self.worst_late = 0.0
+        self.worst_early = 0.0
+        self.critical_days = []
+        self.dead_day = None
+
+    # --- Helpers ---
+
+    def clock(self):
+        return self.t + self.error
+
+    def has(self, phases, name):
+        return bool(phases & self.p[name])
+
+    def charging_at(self, t):
+        return any(start <= t < end for start, end in self.charges)
+
+    def advance(self, seconds, state="awake"):
+        """Moves time forward, and charges the current of the state: `awake`, `light` or `deep` sleep.
+        The RTC drifts in sleep, while awake the main crystal keeps time."""
+
+        if seconds <= 0:
+            return
+        for start, end in self.charges:
+            overlap = min(end, self.t + seconds) - max(start, self.t)
+            if overlap > 0:
+                charged = min(self.used, overlap * 1000 * self.charge_ma)
+                self.used -= charged
+                self.charged += charged
+
+        self.t += seconds
+        if state == "awake":
+            self.awake_seconds += seconds
+            self.used += seconds * 1000 * self.s["POWER_AWAKE_CURRENT"]
+        else:
+            self.error += seconds * self.drift_ppm * 1e-6
+            if state == "light":
+                self.light_sleep_seconds += seconds
+                self.used += seconds * self.light_sleep_ua
+            else:
+                self.used += seconds * self.s["POWER_SLEEP_CURRENT"]
+
+    def refresh(self, kind, wifi_on=False, ahead_ms=0):
+        """Waits for a refresh. The processor light sleeps in it, see `displayBusySleep`,
+        unless WiFi is on, or a frame is rendered ahead first."""
+
+        duration = self.d[kind + "_refresh_ms"] / 1000
+        current = self.s["POWER_FULL_REFRESH_CURRENT"] if kind == "full" else self.s["POWER_PARTIAL_REFRESH_CURRENT"]
+        self.refreshes[kind] += 1
+        self.used += duration * 1000 * current
+        if wifi_on:
+            self.advance(duration)
+        else:
+            awake = min(ahead_ms / 1000, duration)
+            self.advance(awake)
+            self.advance(duration - awake, "light")
+
+    def show(self, minute):
+        """Records the change of the displayed minute, and the error of the previous one."""
+
+        if self.shown is not None:
+            self.worst_late = max(self.worst_late, self.t - (self.shown + 1) * 60)
+            self.worst_early = max(self.worst_early, self.shown * 60 - self.shown_since)
+        self.shown = minute
+        self.shown_since = self.t
+
+    def forget(self):
+        """Like `clockForget`, and a new draw dropping the frame drawn ahead."""
+
+        self.face_shown = None
+        self.ahead = None
+
+    def voltage(self):
+        """The resting voltage of the battery, from the inverse of the discharge curve."""
+
+        percent = max(0.0, 100.0 * (1 - self.used / self.capacity))
+        for (mv_high, p_high), (mv_low, p_low) in zip(self.curve, self.curve[1:]):
+            if percent >= p_low:
+                return mv_low + (mv_high - mv_low) * (percent - p_low) / max(p_high - p_low, 1)
+        return self.curve[-1][0]
+
+    def percent(self, millivolts):
+        """Like `batteryPercent`, interpolated on the discharge curve."""
+
+        for (mv_high, p_high), (mv_low, p_low) in zip(self.curve, self.curve[1:]):
+            if millivolts >= mv_low:
+                return min(100, round(p_low + (p_high - p_low) * (millivolts - mv_low) / max(mv_high - mv_low, 1)))
+        return 0
+
+    def values(self):
+        return self.face.values(self.clock(), self.battery_percent, self.charging, self.last_sync)
+
+    def pending(self):
+        """The mode requested by a button pressed while awake, see `attachModeInterrupts`.
+        Presses of buttons without an interrupt are lost."""
+
+        while self.buttons and self.buttons[0][0] <= self.t:
+            event = self.buttons.pop(0)[1]
+            if event["button"] == "ota" and self.mode != self.m["UPDATE"]:
+                return self.m["UPDATE"], event
+            if event["button"] in ("top", "bottom") and self.mode == self.m["NORMAL"]:
+                return (self.m["SECONDS"] if event["button"] == "top" else self.m["STOPPER"]), event
+            self.presses_lost += 1
+        return None, None
+
+    # --- Phases ---
+
+    def critical(self):
+        """Shows the warning, and sleeps until charging starts."""
+
+        fast = "AUX_FOR_DISP" not in self.s and "PREFER_FAST_REFRESH" in self.s
+        self.forget()
+        self.refresh("fast" if fast else "full")
+        self.show(None)
+        self.hibernated = True
+        self.critical_days.append(self.t / 86400)
+
+        starts = [start for start, _ in self.charges if start > self.t]
+        if not starts:
+            self.advance(self.end - self.t, "deep")
+            return None
+        self.advance(min(starts) - self.t, "deep")
+        return 1 << self.modes.wake["UNKNOWN"]
+
+    def update(self, event):
+        """Stalls with the message on the display, until the update button is pressed again."""
+
+        fast = "AUX_FOR_DISP" not in self.s and "PREFER_FAST_REFRESH" in self.s
+        self.forget()
+        self.refresh("fast" if fast else "full")
+        self.show(None)
+        self.advance((event or {}).get("update_minutes", DEFAULT_UPDATE_MINUTES) * 60)
+        self.updates += 1
+
+        # Only the update button has an interrupt in update mode.
+        while self.buttons and self.buttons[0][0] <= self.t:
+            self.buttons.pop(0)
+            self.presses_lost += 1
+        return self.m["NORMAL"]
+
+    def sync(self, phases, wifi_start):
+        """Waits for the time sync, WiFi was started by the boot steps.
+        There is no timeout in the firmware, outages block."""
+
+        wait = max(0.0, wifi_start + self.d["wifi_sync_ms"] / 1000 - self.t)
+        for start, end in self.outages:
+            if start <= self.t < end:
+                wait += end - self.t
+        self.advance(wait)
+        self.radio_seconds += self.t - wifi_start
+        self.used += (self.t - wifi_start) * 1000 * self.s["POWER_WIFI_CURRENT"]
+        self.syncs += 1
+
+        # The jump of the clock, as measured by the firmware.
+        deviation = int(round(-self.error * 1000))
+        self.error = 0.0
+
+        if self.has(phases, "SHIFT"):
+            shift = deviation + self.shift_average
+            self.shift_average = cdiv(shift + self.shift_average * 3, 4)
+            self.shift_samples += 1
+            self.correction_step = cdiv(self.shift_average, self.s["RESYNC_EVERY"])
+        if self.has(phases, "RESCHEDULE"):
+            self.boot_num -= self.boot_num % self.s["RESYNC_EVERY"]
+
+        self.last_sync = math.floor(self.clock() / 60) % 1440
+
+    def seconds_mode(self, event):
+        """Counts the seconds, until the button is pressed again, or the limit is reached."""
+
+        count = min(int(event.get("seconds", self.s["MAX_DISPLAYED_SECONDS"])), self.s["MAX_DISPLAYED_SECONDS"])
+        self.forget()
+        self.refresh("full" if "AUX_FOR_DISP" in self.s else "fast")
+        self.show(math.floor(self.clock() / 60))
+        for _ in range(count - 1):
+            self.advance(1 - (self.clock() % 1), "light")
+            if math.floor(self.clock()) % 60 == 0:
+                self.refresh("fast")
+                self.show(math.floor(self.clock() / 60))
+            else:
+                self.refresh("window")
+
+    def stopper_mode(self, event):
+        """Runs the stopper, if it is started before the idle timeout."""
+
+        self.forget()
+        self.refresh("full" if "AUX_FOR_DISP" in self.s else "fast")
+        self.show(None)
+
+        start_after = event.get("start_after", 2)
+        if start_after > self.s["STOPPER_IDLE_TIMEOUT"]:
+            self.advance(self.s["STOPPER_IDLE_TIMEOUT"], "light")
+            return
+
+        self.advance(start_after, "light")
+        run = min(event.get("run_seconds", 60), self.s["STOPPER_MAX_MINUTES"] * 60)
+        elapsed = 0
+        while elapsed + self.s["STOPPER_UPDATE_EVERY"] < run:
+            self.advance(self.s["STOPPER_UPDATE_EVERY"] - (elapsed % self.s["STOPPER_UPDATE_EVERY"]), "light")
+            elapsed += self.s["STOPPER_UPDATE_EVERY"]
+            self.refresh("window")
+        self.advance(run - elapsed, "light")
+        self.refresh("window")
+
+        # The result is kept on the display until the minute.
+        self.advance(60 - math.floor(self.clock()) % 60, "light")
+
+    def final_render(self, phases, last_mode):
+        """Draws the clock, like the end of `setup()`. Returns False if nothing was refreshed."""
+
+        # The coming minute is loaded now, if it is really close.
+        clock = self.clock()
+        if self.has(phases, "WAIT_MINUTE") and math.floor(clock) % 60 > 59 - self.s["OMIT_SLEEP"]:
+            clock += 60 - math.floor(clock) % 60
+        minute = math.floor(clock / 60)
+        values = self.face.values(clock, self.battery_percent, self.charging, self.last_sync)
+
+        fast = False
+        if "AUX_FOR_DISP" not in self.s:
+            if "PREFER_FAST_REFRESH" in self.s:
+                fast = True
+            else:
+                fast = bool(self.mode & (self.m["NORMAL"] + self.m["RESYNC"])) and \
+                    bool(last_mode & (self.m["RESET"] + self.m["NORMAL"] + self.m["RESYNC"]))
+        if self.boot_num % self.s["FULL_REFRESH_EVERY"] == 0:
+            fast = False
+
+        all_fields = self.face.field["ALL"]
+        fields = self.face.changed(self.face_shown, values) if fast else all_fields
+        if fields == 0:
+            return False
+
+        # The last boot may have rendered this frame already, see `displayAheadFields`.
+        self.renders += 1
+        if self.ahead is not None and self.ahead[0] == values and (self.ahead[1] & fields) == fields and \
+                (fast or self.ahead[1] == all_fields):
+            fields = self.ahead[1]
+            self.renders_ahead += 1
+        else:
+            if fields != all_fields:
+                fields = self.face.window(fields)
+            self.advance(self.d["render_ms"] / 1000)
+        self.ahead = None
+
+        # The frame is loaded, and the refresh waits for its minute in light sleep.
+        self.advance(minute * 60 - self.clock(), "light")
+
+        # The next minute is rendered while the display refreshes, if only the window changes.
+        ahead_ms = 0
+        if "RENDER_AHEAD" in self.s:
+            next_values = self.face.values((minute + 1) * 60, self.battery_percent, self.charging, self.last_sync)
+            if (self.face.changed(values, next_values) & ~fields) == 0:
+                self.ahead = (next_values, fields)
+                ahead_ms = self.d["render_ms"]
+
+        self.refresh("full" if not fast else ("fast" if fields == all_fields else "window"), ahead_ms=ahead_ms)
+        self.show(minute)
+        self.face_shown = values
+        return True
+
+    # --- Boots ---
+
+    def boot(self, wakes, event):
+        """Replays one call of `setup()`, followed by the deep sleep. Returns the wakes of the next boot, and its button."""
+
+        self.boots += 1
+        charging = self.charging_at(self.t)
+        last_mode = self.mode
+        self.mode = self.modes.select(wakes, self.desired_mode, last_mode, charging and not self.charging,
+                                      self.boot_num % self.s["RESYNC_EVERY"] == 0)
+        self.desired_mode = self.m["NULL"]
+        if charging and not self.charging:
+            self.charge_starts += 1
+        self.charging = charging
+
+        # Fast boot skips the Arduino initialization, see `fastBootPossible`.
+        fast_boot = "FAST_BOOT" in self.s and wakes == (1 << self.modes.wake["TIMER"]) and self.mode == self.m["NORMAL"]
+        self.fast_boots += fast_boot
+        self.advance((self.s["POWER_BOOT_TIME"] - (self.d["arduino_init_ms"] if fast_boot else 0)) / 1000)
+        self.advance(self.d["setup_ms"] / 1000)
+        self.error += self.correction_step / 1000
+
+        # The boot steps: WiFi starts first, then the display initializes while the battery is measured.
+        phases = self.modes.phases_of(self.mode)
+        wifi_start = self.t
+        wipe = self.has(phases, "WIPE")
+        if wipe:
+            self.forget()
+        warm = "WARM_DISPLAY_INIT" in self.s and "AUX_FOR_DISP" not in self.s and self.hibernated and not wipe
+        self.warm_inits += warm
+        self.advance(self.d["display_warm_init_ms" if warm else "display_init_ms"] / 1000)
+        self.hibernated = False
+
+        if self.boot_num % self.s["BATT_SENSE_EVERY"] == 0 or self.has(phases, "MEASURE"):
+            self.used += self.s["POWER_ADC_CHARGE"]
+            self.battery_percent = self.percent(self.voltage())
+            if self.voltage() <= self.s["CRITICAL_BATTERY_LEVEL"] and not charging:
+                self.mode = self.m["CRITICAL"]
+                phases = self.modes.phases_of(self.mode)
+
+        if self.has(phases, "CRITICAL"):
+            return self.critical(), None
+
+        # The modes, buttons pressed while awake switch them in place, see `runMode`.
+        while True:
+
+            # A fast boot runs the skipped initialization before a mode that needs it, see `fastBootInitRuntime`.
+            phases = self.modes.phases_of(self.mode)
+            if fast_boot and phases & self.modes.need_runtime:
+                self.advance(self.d["arduino_init_ms"] / 1000)
+                fast_boot = False
+
+            switch = None
+
+            if self.has(phases, "UPDATE"):
+                switch = self.update(event)
+            if self.has(phases, "CLEAR"):
+                self.forget()
+                self.refresh("fast", wifi_on=self.has(phases, "SYNC"))
+                self.show(None)
+            if self.has(phases, "SYNC"):
+                self.sync(phases, wifi_start)
+            if self.has(phases, "SECONDS"):
+                self.seconds_mode(event)
+            if self.has(phases, "STOPPER"):
+                self.stopper_mode(event)
+
+            if switch is None:
+                switch, event = self.pending()
+            if switch is None:
+                self.final_render(phases, last_mode)
+                switch, event = self.pending()
+            if switch is None:
+                break
+
+            self.switches += 1
+            last_mode, self.mode = self.mode, switch
+
+        self.hibernated = True
+        self.boot_num += 1
+
+        # Sleep until the next minute, a button press, or the start of charging.
+        tm_sec = math.floor(self.clock()) % 60
+        sleep = (60 - tm_sec) - self.s["SLEEP_MARGIN"] / 1000
+        wake, wakes, pressed = self.t + sleep, 1 << self.modes.wake["TIMER"], None
+        if not charging:
+            starts = [start for start, _ in self.charges if self.t < start < wake]
+            if starts:
+                wake, wakes = min(starts), 1 << self.modes.wake["UNKNOWN"]
+        if self.buttons and self.buttons[0][0] < wake:
+            wake = max(self.buttons[0][0], self.t)
+            pressed = self.buttons.pop(0)[1]
+            wakes = 1 << self.modes.wake[pressed["button"].upper() + "_BUTTON"]
+
+        while self.drifts and self.drifts[0][0] <= wake:
+            self.drift_ppm = self.drifts.pop(0)[1]
+        self.advance(wake - self.t, "deep")
+
+        return wakes, pressed
+
+    def run(self):
+
+        wakes, event = 1 << self.modes.wake["POWER_ON"], None
+        while self.t < self.end and wakes is not None:
+            if self.used >= self.capacity:
+                self.dead_day = self.t / 86400
+                break
+            wakes, event = self.boot(wakes, event)
+        self.show(None)
+
+    # --- Report ---
+
+    def report(self):
+
+        days = self.t / 86400
+        energy_mah = (self.used + self.charged) / 3600000
+        lines = [
+            "Simulated days:          %.2f" % days,
+            "Boots:                   %d (%d fast, %d warm display)" % (self.boots, self.fast_boots, self.warm_inits),
+            "Mode switches in a boot: %d" % self.switches,
+            "Presses lost:            %d" % self.presses_lost,
+            "Refreshes (full):        %d" % self.refreshes["full"],
+            "Refreshes (fast):        %d" % self.refreshes["fast"],
+            "Refreshes (window):      %d" % self.refreshes["window"],
+            "Clock faces drawn ahead: %d of %d" % (self.renders_ahead, self.renders),
+            "Syncs:                   %d" % self.syncs,
+            "Updates:                 %d" % self.updates,
+            "Charges:                 %d" % self.charge_starts,
+            "Radio on:                %.1f s" % self.radio_seconds,
+            "Awake:                   %.1f s" % self.awake_seconds,
+            "Light sleep:             %.1f s" % self.light_sleep_seconds,
+            "Worst displayed late:    %.3f s" % self.worst_late,
+            "Worst displayed early:   %.3f s" % self.worst_early,
+            "Final clock error:       %.3f s" % self.error,
+            "Correction step:         %d ms / boot" % self.correction_step,
+            "Energy (estimate):       %.2f mAh (%.3f mAh / day)" % (energy_mah, energy_mah / max(days, 1e-9)),
+            "Charged:                 %.2f mAh" % (self.charged / 3600000),
+            "Battery voltage at end:  %d mV" % self.voltage(),
+        ]
+        for day in self.critical_days:
+            lines.append("Critical mode on day:    %.2f" % day)
+        if self.dead_day is not None:
+            lines.append("Battery empty on day:    %.2f" % self.dead_day)
+        return "\n".join(lines)
+
+
+# --- Entry ---
+
+def main():
+
+    parser = argparse.ArgumentParser(description="Replays the clock's boot logic on a scripted timeline.")
+    parser.add_argument("timeline", help="JSON timeline, see `month.json`.")
+    parser.add_argument("-D", dest="overrides", action="append", default=[], metavar="NAME=VALUE",
+                        help="Override a define from `settings.h`.")
+    args = parser.parse_args()
+
+    with open(args.timeline) as file:
+        timeline = json.load(file)
+
+    replay = Replay(read_settings(args.overrides), timeline)
+    replay.run()
+    print(replay.report())
+
+
+if __name__ == "__main__":
+    sys.exit(main())
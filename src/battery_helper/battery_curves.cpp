@@ -0,0 +1,33 @@
+#include "battery_helper.h"
+
+
+// --- Validation ---
+static_assert(batteryCurveIsValid(BATTERY_CURVE, sizeof(BATTERY_CURVE) / sizeof(BATTERY_CURVE[0])),
+    "BATTERY_CURVE must have strictly decreasing voltages, and non increasing percentages.");
+
+
+// --- Battery Related Functions ---
+
+/// @brief Estimates the charge of the battery from its voltage, using the selected discharge curve.
+/// Interpolation is done with integers only, there is no floating point math involved.
+/// @param millivolts The battery voltage in millivolts.
+/// @return The battery percent from 0 to 100.
+uint8_t batteryPercent(uint32_t millivolts) {
+
+    const size_t count = sizeof(BATTERY_CURVE) / sizeof(BATTERY_CURVE[0]);
+
+    // Clamp to the ends of the curve.
+    if (millivolts >= (uint32_t)(BATTERY_CURVE[0].millivolts - FULL_BATTERY_TOLERANCE)) return 100;
+    if (millivolts <= BATTERY_CURVE[count - 1].millivolts) return BATTERY_CURVE[count - 1].percent;
+
+    // Find the segment, and interpolate with rounding.
+    size_t i = 1;
+    while (millivolts < BATTERY_CURVE[i].millivolts) i++;
+    const BatteryCurvePoint& high = BATTERY_CURVE[i - 1];
+    const BatteryCurvePoint& low = BATTERY_CURVE[i];
+
+    const uint32_t span_mv = high.millivolts - low.millivolts;
+    const uint32_t span_percent = high.percent - low.percent;
+    return low.percent + ((millivolts - low.millivolts) * span_percent + span_mv / 2) / span_mv;
+
+}
@@ -0,0 +1,66 @@
+#ifndef BATTERY_CURVES_H
+#define BATTERY_CURVES_H
+
+// --- Libraries ---
+#include <stdint.h>
+#include <stddef.h>
+
+
+// --- Curve Format ---
+
+/*
+    A discharge curve is a list of points, ordered by decreasing voltage.
+    The percentage is linearly interpolated between the points, and clamped
+    to the first and last points outside of the curve.
+    To support a different cell chemistry, add a new table here, and select
+    it with the `BATTERY_CURVE` option in `settings.h`.
+*/
+struct BatteryCurvePoint {
+    uint16_t millivolts;
+    uint8_t percent;
+};
+
+
+// --- Curves ---
+
+/*
+    Single cell LiPo resting voltages.
+    Source: https://blog.ampow.com/lipo-voltage-chart/
+*/
+constexpr BatteryCurvePoint battery_curve_lipo[] = {
+    { 4200, 100 },
+    { 4150,  95 },
+    { 4110,  90 },
+    { 4080,  85 },
+    { 4020,  80 },
+    { 3980,  75 },
+    { 3950,  70 },
+    { 3910,  65 },
+    { 3870,  60 },
+    { 3850,  55 },
+    { 3840,  50 },
+    { 3820,  45 },
+    { 3800,  40 },
+    { 3790,  35 },
+    { 3770,  30 },
+    { 3750,  25 },
+    { 3730,  20 },
+    { 3710,  15 },
+    { 3690,  10 },
+    { 3610,   5 },
+    { 3270,   0 },
+};
+
+
+// --- Validation ---
+
+/// @brief Checks at compile time, that the voltages are strictly decreasing, and the percentages are not increasing.
+constexpr bool batteryCurveIsValid(const BatteryCurvePoint* curve, size_t count) {
+    return (count < 2) || (
+        (curve[0].millivolts > curve[1].millivolts) &&
+        (curve[0].percent >= curve[1].percent) &&
+        batteryCurveIsValid(curve + 1, count - 1)
+    );
+}
+
+#endif /* BATTERY_CURVES_H */
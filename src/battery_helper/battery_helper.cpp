@@ -0,0 +1,121 @@
+#include "battery_helper.h"
+
+#include <driver/adc.h>
+#include <esp_adc_cal.h>
+
+
+// --- Globals ---
+
+/*
+    Characterizing the eFuse calibration is only needed once.
+    Variables labelled with `RTC_DATA_ATTR` persist in deep sleep,
+    and are initialized again after every other reset.
+*/
+esp_adc_cal_characteristics_t RTC_DATA_ATTR adc_chars;
+bool RTC_DATA_ATTR adc_chars_valid = false;
+
+
+// --- Helper Functions ---
+
+/// @brief Sorts the samples in place. Insertion sort is fast enough for a few dozen samples.
+/// @param samples The samples to sort.
+/// @param count The number of samples.
+static void batterySortSamples(uint16_t* samples, uint16_t count) {
+
+    for (uint16_t i = 1; i < count; i++) {
+        const uint16_t sample = samples[i];
+        uint16_t j = i;
+        while (j > 0 && samples[j - 1] > sample) {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = sample;
+    }
+
+}
+
+
+// --- Battery Related Functions ---
+
+/// @brief Measures the battery voltage with DMA sampling, and a trimmed mean.
+/// Handles the aux power if the voltage divider needs it.
+/// @return The calibrated battery voltage in millivolts, or 0 if the measurement failed.
+uint32_t batteryMeasure() {
+
+    uint8_t result_buf[ADC_OVER_SAMPLE_COUNT * SOC_ADC_DIGI_RESULT_BYTES];
+    uint32_t result_len = 0;
+
+    // Configure continuous sampling first,
+    // so the aux power only has to be on while actually sampling.
+    adc_digi_init_config_t init_config = {
+        .max_store_buf_size = sizeof(result_buf),
+        .conv_num_each_intr = sizeof(result_buf),
+        .adc1_chan_mask = BIT(BATT_SENSE_ADC_CH),
+        .adc2_chan_mask = 0,
+    };
+    adc_digi_initialize(&init_config);
+
+    adc_digi_pattern_config_t pattern = {
+        .atten = ADC_ATTEN_DB_11,
+        .channel = BATT_SENSE_ADC_CH,
+        .unit = 0, // ADC1
+        .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+    };
+    adc_digi_configuration_t dig_config = {
+        .conv_limit_en = false,
+        .conv_limit_num = 250,
+        .pattern_num = 1,
+        .adc_pattern = &pattern,
+        .sample_freq_hz = ADC_SAMPLE_FREQUENCY,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+    };
+    adc_digi_controller_configure(&dig_config);
+
+    // Turn on the aux power if the voltage divider needs it, and let it settle.
+    #if defined(AUX_FOR_BATT_SENSE)
+        digitalWrite(AUX_PWR_PIN, HIGH);
+        delayMicroseconds(ADC_SETTLE_TIME);
+    #endif /* AUX_FOR_BATT_SENSE */
+
+    // Collect all the samples in one go.
+    adc_digi_start();
+    adc_digi_read_bytes(result_buf, sizeof(result_buf), &result_len, ADC_READ_TIMEOUT);
+    adc_digi_stop();
+
+    // Turn off the aux power if display does not need it.
+    #if !defined(AUX_FOR_DISP)
+        digitalWrite(AUX_PWR_PIN, LOW);
+    #endif /* !AUX_FOR_DISP */
+
+    adc_digi_deinitialize();
+
+    // Extract the samples of our channel.
+    uint16_t samples[ADC_OVER_SAMPLE_COUNT];
+    uint16_t sample_count = 0;
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= result_len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t* result = (const adc_digi_output_data_t*)&result_buf[i];
+        if (result->type2.unit == 0 && result->type2.channel == BATT_SENSE_ADC_CH) {
+            samples[sample_count++] = result->type2.data;
+        }
+    }
+
+    // Not enough samples to trim, the measurement failed.
+    if (sample_count <= 2 * ADC_TRIM_COUNT) return 0;
+
+    // Average the samples, without the outliers on either end.
+    batterySortSamples(samples, sample_count);
+    uint32_t battery_raw = 0;
+    for (uint16_t i = ADC_TRIM_COUNT; i < sample_count - ADC_TRIM_COUNT; i++) {
+        battery_raw += samples[i];
+    }
+    battery_raw = battery_raw / (sample_count - 2 * ADC_TRIM_COUNT);
+
+    // Calibrate the battery voltage reading. The characteristics are cached.
+    if (!adc_chars_valid) {
+        esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &adc_chars);
+        adc_chars_valid = true;
+    }
+    return esp_adc_cal_raw_to_voltage(battery_raw, &adc_chars) * ADC_FACTOR;
+
+}
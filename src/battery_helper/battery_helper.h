@@ -0,0 +1,18 @@
+#ifndef BATTERY_HELPER_H
+#define BATTERY_HELPER_H
+
+// --- Libraries ---
+#include <Arduino.h>
+
+// --- Settings and Pins ---
+#include "settings.h"
+#include "pins.h"
+
+// --- Discharge Curves ---
+#include "battery_curves.h"
+
+// --- Functions ---
+uint32_t batteryMeasure();
+uint8_t batteryPercent(uint32_t millivolts);
+
+#endif /* BATTERY_HELPER_H */
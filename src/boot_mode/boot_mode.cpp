@@ -0,0 +1,79 @@
+#include "boot_mode.h"
+
+
+// --- Transition Table ---
+
+/// @brief The mode a wake source leads to, unless the last mode was the blocking one.
+struct BootTransition {
+    uint8_t wake;
+    uint8_t mode;
+    uint8_t blocked_by;
+};
+
+/*
+    Rows are indexed by the wake source, and the first row of the reported
+    sources that is not blocked decides, so the order is also the priority.
+    A button pressed to exit a mode must not enter it again, for example
+    the update button after update mode, that is what `blocked_by` is for.
+    An other button held with it still selects its own mode.
+    Resets lead to no mode, so they are decided by the desired mode.
+*/
+static constexpr BootTransition boot_transitions[WAKE_COUNT] = {
+    { WAKE_POWER_ON,      NULL_MODE,    NULL_MODE   },
+    { WAKE_SOFT_RESET,    NULL_MODE,    NULL_MODE   },
+    { WAKE_TIMER,         NORMAL_MODE,  NULL_MODE   },
+    { WAKE_OTA_BUTTON,    UPDATE_MODE,  UPDATE_MODE },
+    { WAKE_TOP_BUTTON,    SECONDS_MODE, NULL_MODE   },
+    { WAKE_BOTTOM_BUTTON, STOPPER_MODE, NULL_MODE   },
+    { WAKE_UNKNOWN,       NULL_MODE,    NULL_MODE   },
+};
+
+/// @brief Checks that every row is at the index of its wake source.
+constexpr bool bootTransitionsAreOrdered(uint8_t i = 0) {
+
+    return (i >= WAKE_COUNT) ||
+        ((boot_transitions[i].wake == i) && bootTransitionsAreOrdered(i + 1));
+
+}
+
+static_assert(bootTransitionsAreOrdered(), "Boot transitions must be ordered by wake source!");
+
+
+// --- Mode Functions ---
+
+/// @brief Selects the mode of the current boot. Critical mode is not selected here, as it depends on a measurement.
+/// @param inputs The wake sources, the requested and last modes, and the state of charging and the schedule.
+/// @return A single mode bit, never the null mode.
+uint8_t bootModeSelect(const BootModeInputs& inputs) {
+
+    uint8_t mode = NULL_MODE;
+
+    // A valid desired mode has the highest priority, otherwise the wake source decides.
+    if (inputs.desired_mode & (NORMAL_MODE + UPDATE_MODE + SECONDS_MODE + STOPPER_MODE + RESET_MODE)) {
+        mode = inputs.desired_mode;
+    } else {
+        for (uint8_t i = 0; i < WAKE_COUNT; i++) {
+            const BootTransition& transition = boot_transitions[i];
+            if (!(inputs.wakes & (1 << transition.wake))) continue;
+            if ((transition.blocked_by != NULL_MODE) && (inputs.last_mode == transition.blocked_by)) continue;
+            mode = transition.mode;
+            break;
+        }
+    }
+
+    // If charging has just started, we can use the external power for maintenance.
+    // Modes requested by the user are not interrupted.
+    if (inputs.charging_started && ((mode == NULL_MODE) || (mode == NORMAL_MODE))) {
+        mode = CHARGING_MODE;
+    }
+
+    // If we are in normal mode, we may need to do a resync.
+    if ((mode == NORMAL_MODE) && inputs.resync_due) mode = RESYNC_MODE;
+
+    // If we are not in any mode yet, just say we were in a reset.
+    // (An error could occur if we soft reset without a valid desired mode.)
+    if (mode == NULL_MODE) mode = RESET_MODE;
+
+    return mode;
+
+}
@@ -0,0 +1,97 @@
+#ifndef BOOT_MODE_H
+#define BOOT_MODE_H
+
+// --- Libraries ---
+#include <Arduino.h>
+
+
+// --- Mode Numbering ---
+#define NULL_MODE     0b00000000
+#define RESET_MODE    0b00000001
+#define NORMAL_MODE   0b00000010
+#define RESYNC_MODE   0b00000100
+#define SECONDS_MODE  0b00001000
+#define STOPPER_MODE  0b00010000
+#define UPDATE_MODE   0b00100000
+#define CRITICAL_MODE 0b01000000
+#define CHARGING_MODE 0b10000000
+#define MODE_COUNT    8
+
+
+// --- Wake Sources ---
+
+/*
+    The reasons of the current boot, reduced to what matters for choosing
+    the mode. They are reported as a mask of `1 << WAKE_` bits, as every
+    button still pressed after a wakeup is reported.
+*/
+enum BootWake : uint8_t {
+    WAKE_POWER_ON,
+    WAKE_SOFT_RESET,
+    WAKE_TIMER,
+    WAKE_OTA_BUTTON,
+    WAKE_TOP_BUTTON,
+    WAKE_BOTTOM_BUTTON,
+    WAKE_UNKNOWN,
+    WAKE_COUNT
+};
+
+#define WAKE_BUTTONS ((1 << WAKE_OTA_BUTTON) | (1 << WAKE_TOP_BUTTON) | (1 << WAKE_BOTTOM_BUTTON))
+
+/// @brief Everything the mode of a boot depends on.
+struct BootModeInputs {
+    uint8_t wakes;
+    uint8_t desired_mode;
+    uint8_t last_mode;
+    bool charging_started;
+    bool resync_due;
+};
+
+
+// --- Phases ---
+
+/*
+    The work done by each mode is a set of phases, run by `setup` in a
+    fixed order. Adding a mode only needs a new row in the table below,
+    the checks in the hot path stay the same.
+*/
+#define PHASE_WIPE          0x0001 // Wipe the display on init.
+#define PHASE_MEASURE       0x0002 // Measure the battery, regardless of the schedule.
+#define PHASE_CRITICAL      0x0004 // Show the warning, and sleep until charging starts.
+#define PHASE_UPDATE        0x0008 // Stall for OTA updates.
+#define PHASE_CLEAR         0x0010 // Clear the display before the sync.
+#define PHASE_SYNC          0x0020 // Connect to WiFi, and sync the time.
+#define PHASE_SHIFT         0x0040 // Update the time shift averages from the sync.
+#define PHASE_RESCHEDULE    0x0080 // Restart the resync schedule from this boot.
+#define PHASE_SECONDS       0x0100 // Display the seconds.
+#define PHASE_STOPPER       0x0200 // Run the stopper.
+#define PHASE_WAIT_MINUTE   0x0400 // Load the coming minute if it is close, and wait for it in light sleep before the refresh.
+
+// The phases that need the Arduino runtime, skipped by a fast boot. See `FAST_BOOT` in `settings.h`.
+#define PHASES_NEED_RUNTIME (PHASE_SYNC | PHASE_UPDATE)
+
+constexpr uint16_t boot_mode_phases[MODE_COUNT] = {
+    /* RESET    */ PHASE_WIPE | PHASE_CLEAR | PHASE_SYNC | PHASE_WAIT_MINUTE,
+    /* NORMAL   */ PHASE_WAIT_MINUTE,
+    /* RESYNC   */ PHASE_SYNC | PHASE_SHIFT | PHASE_WAIT_MINUTE,
+    /* SECONDS  */ PHASE_SECONDS,
+    /* STOPPER  */ PHASE_STOPPER,
+    /* UPDATE   */ PHASE_UPDATE,
+    /* CRITICAL */ PHASE_WIPE | PHASE_CRITICAL,
+    /* CHARGING */ PHASE_WIPE | PHASE_MEASURE | PHASE_SYNC | PHASE_RESCHEDULE | PHASE_WAIT_MINUTE,
+};
+
+/// @brief Looks up the phases of a mode.
+/// @param mode A single mode bit.
+/// @return The phases to run, none for the null mode.
+constexpr uint16_t bootModePhases(uint8_t mode) {
+
+    return (mode == NULL_MODE) ? 0 : boot_mode_phases[__builtin_ctz(mode)];
+
+}
+
+
+// --- Functions ---
+uint8_t bootModeSelect(const BootModeInputs& inputs);
+
+#endif /* BOOT_MODE_H */
@@ -0,0 +1,169 @@
+#include "clock_format.h"
+
+#include "rtc_state/rtc_state.h"
+#include "energy_ledger/energy_ledger.h"
+
+
+/*
+    The texts of the clock face are written digit by digit, without
+    `strftime` and `sprintf`, that parse their format on every call.
+
+    The values on the display are kept in the persistent state, so each
+    boot knows which fields it changes. A month of 0 means the clock face
+    is not on the display, after a reset, or an other screen was drawn.
+*/
+
+
+// --- Constants ---
+#define MAX_DAYS_REMAINING  999
+
+
+// --- Helper Functions ---
+
+/// @brief Limits the days remaining to what fits on the display.
+static uint16_t clockDaysShown(uint16_t days_remaining) {
+
+    if (days_remaining == LEDGER_DAYS_UNKNOWN) return LEDGER_DAYS_UNKNOWN;
+    return min(days_remaining, (uint16_t)MAX_DAYS_REMAINING);
+
+}
+
+
+// --- Formatting Functions ---
+
+/// @brief Writes a number in decimal, padded with leading zeros.
+/// @param buf Buffer of at least `width + 1` characters, or 11 if the value may be wider.
+/// @param value The number to write.
+/// @param width The minimum number of digits.
+/// @return Pointer to the terminating null character.
+char* clockFormatDigits(char* buf, uint32_t value, uint8_t width) {
+
+    uint8_t digits = 1;
+    for (uint32_t rest = value / 10; rest > 0; rest /= 10) digits++;
+    if (digits < width) digits = width;
+
+    char* end = buf + digits;
+    *end = '\0';
+    for (char* digit = end - 1; digit >= buf; digit--) {
+        *digit = '0' + value % 10;
+        value /= 10;
+    }
+    return end;
+
+}
+
+/// @brief Copies text, and terminates it.
+/// @return Pointer to the terminating null character.
+char* clockFormatText(char* buf, const char* text) {
+
+    while (*text) *buf++ = *text++;
+    *buf = '\0';
+    return buf;
+
+}
+
+/// @brief Writes an elapsed time of the stopper as minutes and seconds, like `MM:SS.hh`.
+/// @param buf Buffer of at least 12 characters.
+/// @param elapsed_ms Elapsed time in milliseconds.
+/// @param precise If true, hundredths of seconds are also written.
+/// @return Pointer to the terminating null character.
+char* clockFormatStopper(char* buf, uint32_t elapsed_ms, bool precise) {
+
+    char* end = clockFormatDigits(buf, elapsed_ms / 60000, 2);
+    end = clockFormatText(end, ":");
+    end = clockFormatDigits(end, (elapsed_ms / 1000) % 60, 2);
+    if (!precise) return end;
+    end = clockFormatText(end, ".");
+    return clockFormatDigits(end, (elapsed_ms / 10) % 100, 2);
+
+}
+
+
+// --- Clock Face Functions ---
+
+/// @brief Formats the texts of the clock face.
+/// @param values The numbers to show.
+/// @param strings Filled with the texts.
+/// @return Mask of the `CLOCK_FIELD_` bits that differ from the clock face on the display.
+uint8_t clockFormat(const ClockValues& values, ClockStrings& strings) {
+
+    clockFormatDigits(strings.hour, values.hour, 2);
+    clockFormatDigits(strings.minute, values.minute, 2);
+
+    char* end = clockFormatDigits(strings.date, values.year, 4);
+    end = clockFormatText(end, "-");
+    end = clockFormatDigits(end, values.month, 2);
+    end = clockFormatText(end, "-");
+    clockFormatDigits(end, values.day, 2);
+
+    end = clockFormatDigits(strings.battery_value, values.battery_percent, 1);
+    clockFormatText(end, "%");
+
+    const uint16_t days_remaining = clockDaysShown(values.days_remaining);
+    if (days_remaining == LEDGER_DAYS_UNKNOWN) {
+        clockFormatText(strings.days_remaining, "--d");
+    } else {
+        end = clockFormatDigits(strings.days_remaining, days_remaining, 1);
+        clockFormatText(end, "d");
+    }
+
+    clockFormatDigits(strings.last_sync_hour, values.last_sync_hour, 2);
+    clockFormatDigits(strings.last_sync_minute, values.last_sync_minute, 2);
+
+    // Compare to the values on the display.
+    if (rtc_state.shown_month == 0) return CLOCK_FIELD_ALL;
+
+    ClockValues shown;
+    shown.year = rtc_state.shown_year;
+    shown.days_remaining = rtc_state.shown_days_remaining;
+    shown.month = rtc_state.shown_month;
+    shown.day = rtc_state.shown_day;
+    shown.hour = rtc_state.shown_hour;
+    shown.minute = rtc_state.shown_minute;
+    shown.battery_percent = rtc_state.shown_battery_percent;
+    shown.battery_icon = rtc_state.shown_battery_icon;
+    shown.last_sync_hour = rtc_state.shown_last_sync_hour;
+    shown.last_sync_minute = rtc_state.shown_last_sync_minute;
+    return clockChangedFields(shown, values);
+
+}
+
+/// @brief Compares two clock faces.
+/// @return Mask of the `CLOCK_FIELD_` bits with different texts or icons.
+uint8_t clockChangedFields(const ClockValues& a, const ClockValues& b) {
+
+    uint8_t changed = 0;
+    if (a.hour != b.hour) changed |= CLOCK_FIELD_HOUR;
+    if (a.minute != b.minute) changed |= CLOCK_FIELD_MINUTE;
+    if ((a.year != b.year) || (a.month != b.month) || (a.day != b.day)) changed |= CLOCK_FIELD_DATE;
+    if ((a.battery_percent != b.battery_percent) || (a.battery_icon != b.battery_icon)) changed |= CLOCK_FIELD_BATTERY;
+    if (clockDaysShown(a.days_remaining) != clockDaysShown(b.days_remaining)) changed |= CLOCK_FIELD_DAYS_REMAINING;
+    if ((a.last_sync_hour != b.last_sync_hour) || (a.last_sync_minute != b.last_sync_minute)) changed |= CLOCK_FIELD_LAST_SYNC;
+
+    return changed;
+
+}
+
+/// @brief Records the values of the clock face, after it was drawn to the display.
+void clockShown(const ClockValues& values) {
+
+    rtc_state.shown_year = values.year;
+    rtc_state.shown_days_remaining = clockDaysShown(values.days_remaining);
+    rtc_state.shown_month = values.month;
+    rtc_state.shown_day = values.day;
+    rtc_state.shown_hour = values.hour;
+    rtc_state.shown_minute = values.minute;
+    rtc_state.shown_battery_percent = values.battery_percent;
+    rtc_state.shown_battery_icon = values.battery_icon;
+    rtc_state.shown_last_sync_hour = values.last_sync_hour;
+    rtc_state.shown_last_sync_minute = values.last_sync_minute;
+
+}
+
+/// @brief Marks the clock face as not on the display, every field is changed on the next format.
+/// Has to be called before drawing anything else.
+void clockForget() {
+
+    rtc_state.shown_month = 0;
+
+}
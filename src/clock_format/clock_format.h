@@ -0,0 +1,60 @@
+#ifndef CLOCK_FORMAT_H
+#define CLOCK_FORMAT_H
+
+// --- Libraries ---
+#include <Arduino.h>
+
+
+// --- Fields ---
+
+/*
+    The fields of the clock face, as bits of the change masks.
+    A field is changed if its text, or its icon differs from the one
+    on the display.
+*/
+#define CLOCK_FIELD_HOUR            0b00000001
+#define CLOCK_FIELD_MINUTE          0b00000010
+#define CLOCK_FIELD_DATE            0b00000100
+#define CLOCK_FIELD_BATTERY         0b00001000
+#define CLOCK_FIELD_DAYS_REMAINING  0b00010000
+#define CLOCK_FIELD_LAST_SYNC       0b00100000
+#define CLOCK_FIELD_ALL             0b00111111
+#define CLOCK_FIELD_COUNT           6
+
+
+/// @brief The numbers shown on the clock face.
+struct ClockValues {
+    uint16_t year;
+    uint16_t days_remaining;    // `LEDGER_DAYS_UNKNOWN` if there is no estimate yet.
+    uint8_t month;              // From 1 to 12.
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t battery_percent;
+    uint8_t battery_icon;
+    uint8_t last_sync_hour;
+    uint8_t last_sync_minute;
+};
+
+/// @brief The texts of the clock face, sized for the widest value of each.
+struct ClockStrings {
+    char hour[3];
+    char minute[3];
+    char date[11];
+    char battery_value[5];
+    char days_remaining[5];
+    char last_sync_hour[3];
+    char last_sync_minute[3];
+};
+
+
+// --- Functions ---
+char* clockFormatDigits(char* buf, uint32_t value, uint8_t width);
+char* clockFormatText(char* buf, const char* text);
+char* clockFormatStopper(char* buf, uint32_t elapsed_ms, bool precise);
+uint8_t clockFormat(const ClockValues& values, ClockStrings& strings);
+uint8_t clockChangedFields(const ClockValues& a, const ClockValues& b);
+void clockShown(const ClockValues& values);
+void clockForget();
+
+#endif /* CLOCK_FORMAT_H */
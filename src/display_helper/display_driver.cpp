@@ -0,0 +1,257 @@
+#include "display_driver.h"
+
+#include <esp_timer.h>
+
+
+// --- Controller Commands ---
+#define SSD1680_TEMPERATURE_SENSOR 0x18
+#define SSD1680_UPDATE_CONTROL_1   0x21
+#define SSD1680_BORDER_WAVEFORM    0x3C
+#define SSD1680_DATA_ENTRY_MODE    0x11
+#define SSD1680_RAM_X_RANGE        0x44
+#define SSD1680_RAM_Y_RANGE        0x45
+#define SSD1680_RAM_X_COUNTER      0x4E
+#define SSD1680_RAM_Y_COUNTER      0x4F
+#define SSD1680_WRITE_RAM_CURRENT  0x24
+#define SSD1680_WRITE_RAM_PREVIOUS 0x26
+
+// Image RAMs written by each kind of write.
+static const uint8_t write_current[] = { SSD1680_WRITE_RAM_CURRENT };
+static const uint8_t write_both[] = { SSD1680_WRITE_RAM_PREVIOUS, SSD1680_WRITE_RAM_CURRENT };
+
+// The longest wait for the controller after a hardware reset, the same as the fixed delay of GxEPD2.
+#define RESET_BUSY_TIMEOUT 10000
+
+// Copy of the image being refreshed, see `keepImage`.
+// Only needed until the end of the refresh, so it is not kept in RTC memory with the display.
+static uint8_t kept_image[GxEPD2_290_BS::WIDTH / 8 * GxEPD2_290_BS::HEIGHT];
+
+
+// --- Construction ---
+
+/// @brief Creates the driver, with the same pins as `GxEPD2_290_BS`.
+DisplayDriver::DisplayDriver(int16_t cs, int16_t dc, int16_t rst, int16_t busy) :
+    GxEPD2_290_BS(cs, dc, rst, busy) {
+
+    write_time = 0;
+    warm_start = false;
+    _image = NULL;
+    _image_size = 0;
+    _refreshing = false;
+    _image_kept = false;
+    _hold = NULL;
+
+}
+
+
+// --- Initialization ---
+
+/// @brief Initializes the pins and the controller, like `GxEPD2_EPD::init`.
+/// With `warm_start` set, and no initial wipe, only wakes the controller up, see `initWarm`.
+void DisplayDriver::init(uint32_t serial_diag_bitrate, bool initial, uint16_t reset_duration, bool pulldown_rst_mode) {
+
+    if (initial || !warm_start || (_rst < 0)) {
+        GxEPD2_290_BS::init(serial_diag_bitrate, initial, reset_duration, pulldown_rst_mode);
+        return;
+    }
+
+    // The same state as after `GxEPD2_EPD::init` without a wipe.
+    _initial_write = false;
+    _initial_refresh = false;
+    _pulldown_rst_mode = pulldown_rst_mode;
+    _power_is_on = false;
+    _using_partial_mode = false;
+    _reset_duration = reset_duration;
+    if (serial_diag_bitrate > 0) {
+        Serial.begin(serial_diag_bitrate);
+        _diag_enabled = true;
+    }
+
+    digitalWrite(_cs, HIGH);
+    pinMode(_cs, OUTPUT);
+    digitalWrite(_dc, HIGH);
+    pinMode(_dc, OUTPUT);
+    pinMode(_busy, INPUT);
+    _pSPIx->begin();
+
+    initWarm(reset_duration);
+
+}
+
+/// @brief Wakes the controller from deep sleep, and sets the registers GxEPD2 does not leave at their defaults.
+/// The image RAM is untouched, so a partial refresh can follow.
+void DisplayDriver::initWarm(uint16_t reset_duration) {
+
+    // The hardware reset, without the delays before and after it.
+    digitalWrite(_rst, HIGH);
+    pinMode(_rst, OUTPUT);
+    digitalWrite(_rst, LOW);
+    delay(reset_duration);
+    digitalWrite(_rst, HIGH);
+
+    // The controller is ready when it releases the BUSY pin.
+    delay(1);
+    const int64_t reset_end = esp_timer_get_time();
+    while ((digitalRead(_busy) == HIGH) && (esp_timer_get_time() - reset_end < RESET_BUSY_TIMEOUT)) delayMicroseconds(100);
+
+    // Everything else of `GxEPD2_290_BS::_InitDisplay` matches the values after the reset.
+    _writeCommand(SSD1680_BORDER_WAVEFORM);
+    _writeData(0x05);
+    _writeCommand(SSD1680_UPDATE_CONTROL_1);
+    _writeData(0x00);
+    _writeData(0x80); // Source outputs S8 to S167, for the 128 pixel wide panel
+    _writeCommand(SSD1680_TEMPERATURE_SENSOR);
+    _writeData(0x80); // Internal sensor
+
+    _hibernating = false;
+    _init_display_done = true;
+
+}
+
+
+// --- RAM Writes ---
+
+/// @brief Writes an image to the current RAM of the controller.
+void DisplayDriver::writeImage(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm) {
+
+    recordImage(bitmap, w, h);
+    if (writeImageStreamed(write_current, sizeof(write_current), bitmap, x, y, w, h, invert, mirror_y, pgm)) return;
+    GxEPD2_290_BS::writeImage(bitmap, x, y, w, h, invert, mirror_y, pgm);
+
+}
+
+/// @brief Writes an image to both RAMs of the controller, before a full refresh.
+void DisplayDriver::writeImageForFullRefresh(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm) {
+
+    recordImage(bitmap, w, h);
+    if (writeImageStreamed(write_both, sizeof(write_both), bitmap, x, y, w, h, invert, mirror_y, pgm)) return;
+    GxEPD2_290_BS::writeImageForFullRefresh(bitmap, x, y, w, h, invert, mirror_y, pgm);
+
+}
+
+/// @brief Writes an image to both RAMs of the controller after a refresh, as the base of the next partial refresh.
+void DisplayDriver::writeImageAgain(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm) {
+
+    // The frame buffer may hold the next frame already.
+    if (_image_kept) {
+        bitmap = kept_image;
+        _image_kept = false;
+    }
+
+    if (writeImageStreamed(write_both, sizeof(write_both), bitmap, x, y, w, h, invert, mirror_y, pgm)) return;
+    GxEPD2_290_BS::writeImageAgain(bitmap, x, y, w, h, invert, mirror_y, pgm);
+
+}
+
+/// @brief Remembers the image written before a refresh, so it can be kept during the refresh.
+void DisplayDriver::recordImage(const uint8_t bitmap[], int16_t w, int16_t h) {
+
+    _image = bitmap;
+    _image_size = (uint16_t)((w + 7) / 8) * h;
+    _image_kept = false;
+
+}
+
+
+// --- Refreshes ---
+
+/// @brief Refreshes the whole panel.
+/// @param partial_update_mode If true, a partial refresh is done.
+void DisplayDriver::refresh(bool partial_update_mode) {
+
+    runHold();
+    _refreshing = true;
+    GxEPD2_290_BS::refresh(partial_update_mode);
+    _refreshing = false;
+
+}
+
+/// @brief Refreshes a window of the panel with a partial refresh.
+void DisplayDriver::refresh(int16_t x, int16_t y, int16_t w, int16_t h) {
+
+    runHold();
+    _refreshing = true;
+    GxEPD2_290_BS::refresh(x, y, w, h);
+    _refreshing = false;
+
+}
+
+/// @brief Sets a function to call before the next refresh, after the image is written to the RAM.
+/// @param hold The function, it returns when the refresh should start. Only called once.
+void DisplayDriver::holdRefresh(void (*hold)()) {
+
+    _hold = hold;
+
+}
+
+/// @brief Calls the function set by `holdRefresh`, if there is one.
+void DisplayDriver::runHold() {
+
+    if (_hold == NULL) return;
+    void (*hold)() = _hold;
+    _hold = NULL;
+    hold();
+
+}
+
+/// @brief Copies the image of the refresh in progress, the writes after the refresh use the copy.
+/// Has to be called from the busy callback.
+/// @return False if no refresh is in progress, then the frame buffer must not be changed.
+bool DisplayDriver::keepImage() {
+
+    if (!_refreshing || (_image == NULL) || (_image_size > sizeof(kept_image))) return false;
+    if (!_image_kept) memcpy(kept_image, _image, _image_size);
+    _image_kept = true;
+    return true;
+
+}
+
+/// @brief Writes an image to the given RAMs in single transfers, if the image allows it.
+/// @param commands The write commands of the RAMs.
+/// @param command_count The number of RAMs to write.
+/// @return False if the image has to be written by GxEPD2 instead.
+bool DisplayDriver::writeImageStreamed(const uint8_t* commands, uint8_t command_count, const uint8_t bitmap[], int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm) {
+
+    // Only whole byte windows inside the panel have contiguous rows.
+    if (invert || mirror_y || pgm) return false;
+    if ((x < 0) || (y < 0) || (x % 8 != 0) || (w % 8 != 0) || (h <= 0)) return false;
+    if ((x + w > WIDTH) || (y + h > HEIGHT)) return false;
+
+    const int64_t start_time = esp_timer_get_time();
+
+    // Let GxEPD2 initialize the controller, by writing the first byte.
+    GxEPD2_290_BS::writeImage(bitmap, x, y, 8, 1);
+
+    for (uint8_t i = 0; i < command_count; i++) {
+        setRamArea(x, y, w, h);
+        _writeCommand(commands[i]);
+        _startTransfer();
+        _pSPIx->writeBytes(bitmap, (uint32_t)(w / 8) * h);
+        _endTransfer();
+    }
+
+    write_time += esp_timer_get_time() - start_time;
+    return true;
+
+}
+
+/// @brief Sets the window and the address counters of the RAM, in the same way as `GxEPD2_290_BS`.
+void DisplayDriver::setRamArea(int16_t x, int16_t y, int16_t w, int16_t h) {
+
+    _writeCommand(SSD1680_DATA_ENTRY_MODE);
+    _writeData(0x03); // X and Y increase
+    _writeCommand(SSD1680_RAM_X_RANGE);
+    _writeData(x / 8);
+    _writeData((x + w - 1) / 8);
+    _writeCommand(SSD1680_RAM_Y_RANGE);
+    _writeData(y % 256);
+    _writeData(y / 256);
+    _writeData((y + h - 1) % 256);
+    _writeData((y + h - 1) / 256);
+    _writeCommand(SSD1680_RAM_X_COUNTER);
+    _writeData(x / 8);
+    _writeCommand(SSD1680_RAM_Y_COUNTER);
+    _writeData(y % 256);
+    _writeData(y / 256);
+
+}
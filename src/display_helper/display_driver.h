@@ -0,0 +1,86 @@
+#ifndef DISPLAY_DRIVER_H
+#define DISPLAY_DRIVER_H
+
+// --- Libraries ---
+#include <GxEPD2_BW.h>
+#include <Arduino.h>
+#include <SPI.h>
+
+
+// --- Display Driver ---
+
+/*
+    The `GxEPD2_290_BS` driver, with the RAM writes of whole frames
+    streamed to the controller in a single transfer.
+
+    GxEPD2 sends the image data one byte at a time, each a separate SPI
+    transaction, so the bus sits idle most of the time. Here, when the
+    window is inside the panel and the image is not mirrored, inverted or
+    in program memory, the rows are contiguous in the buffer, and are
+    sent with `SPIClass::writeBytes`, that keeps the hardware FIFO full.
+    Other images are written by GxEPD2 as before.
+
+    The controller initialization of GxEPD2 is private, so the first byte
+    of every image is still written by GxEPD2. This brings the controller
+    up in the right mode, then the whole window is written again.
+
+    During a refresh, the image can be kept with `keepImage`. The writes
+    after the refresh then use the copy, and the frame buffer is free to
+    draw the next frame on while the panel is busy.
+
+    With `holdRefresh`, the next refresh waits after the image is written
+    to the RAM, so only the update command is left for the chosen time.
+
+    With `warm_start` set, `init` only wakes the controller from deep sleep.
+    The RAM is kept in deep sleep, and a hardware reset is the only way out
+    of it, but that reset already restores the registers to their defaults.
+    So the fixed delays around the reset, the software reset, and the
+    registers that GxEPD2 sets to their default values are skipped.
+*/
+class DisplayDriver : public GxEPD2_290_BS {
+
+public:
+
+    DisplayDriver(int16_t cs, int16_t dc, int16_t rst, int16_t busy);
+
+    // Replace the initialization of `GxEPD2_290_BS`, to allow a warm start.
+    void init(uint32_t serial_diag_bitrate, bool initial, uint16_t reset_duration = 10, bool pulldown_rst_mode = false);
+
+    // Replace the RAM writes of `GxEPD2_290_BS`.
+    void writeImage(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w, int16_t h, bool invert = false, bool mirror_y = false, bool pgm = false);
+    void writeImageForFullRefresh(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w, int16_t h, bool invert = false, bool mirror_y = false, bool pgm = false);
+    void writeImageAgain(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w, int16_t h, bool invert = false, bool mirror_y = false, bool pgm = false);
+
+    // Replace the refreshes of `GxEPD2_290_BS`, to know when one is in progress.
+    void refresh(bool partial_update_mode = false);
+    void refresh(int16_t x, int16_t y, int16_t w, int16_t h);
+
+    // Copies the image of the refresh in progress, for the writes after it.
+    bool keepImage();
+
+    // Sets a function to call before the next refresh starts.
+    void holdRefresh(void (*hold)());
+
+    // Time spent writing images since the start, in microseconds.
+    uint32_t write_time;
+
+    // If true, the next `init` is a warm start. Only valid after a clean hibernation.
+    bool warm_start;
+
+private:
+
+    bool writeImageStreamed(const uint8_t* commands, uint8_t command_count, const uint8_t bitmap[], int16_t x, int16_t y, int16_t w, int16_t h, bool invert, bool mirror_y, bool pgm);
+    void setRamArea(int16_t x, int16_t y, int16_t w, int16_t h);
+    void recordImage(const uint8_t bitmap[], int16_t w, int16_t h);
+    void runHold();
+    void initWarm(uint16_t reset_duration);
+
+    const uint8_t* _image;  // The last image written, usually the frame buffer.
+    uint16_t _image_size;
+    bool _refreshing;
+    bool _image_kept;
+    void (*_hold)();
+
+};
+
+#endif /* DISPLAY_DRIVER_H */
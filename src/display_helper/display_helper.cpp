@@ -1,8 +1,58 @@
 # include "display_helper.h"
 
+#include <esp_timer.h>
+
 
 // --- Globals ---
-GxEPD2_BW<GxEPD2_290_BS, GxEPD2_290_BS::HEIGHT> RTC_DATA_ATTR display(GxEPD2_290_BS(/*CS=*/ DISP_CS_PIN, /*DC=*/ DISP_DC_PIN, /*RST=*/ DISP_RES_PIN, /*BUSY=*/ DISPLAY_BUSY_PIN));
+#if defined(VIRTUAL_DISPLAY)
+    VirtualDisplay display(GxEPD2_290_BS::WIDTH, GxEPD2_290_BS::HEIGHT, Serial);
+#else
+    GxEPD2_BW<DisplayDriver, DisplayDriver::HEIGHT> RTC_DATA_ATTR display(DisplayDriver(/*CS=*/ DISP_CS_PIN, /*DC=*/ DISP_DC_PIN, /*RST=*/ DISP_RES_PIN, /*BUSY=*/ DISPLAY_BUSY_PIN));
+#endif /* VIRTUAL_DISPLAY */
+
+// Time spent on refreshes in this boot in milliseconds, used for power accounting.
+uint32_t display_full_refresh_time = 0;
+uint32_t display_partial_refresh_time = 0;
+bool display_partial_refresh = false;
+
+/*
+    Set when the display is hibernated, and cleared when it is initialized.
+    The controller keeps its RAM in deep sleep, so the next boot can wake
+    it up without a full initialization. Like the frame buffer, this is
+    cleared by resets, when the state of the display is not known.
+*/
+static bool RTC_DATA_ATTR display_hibernated = false;
+
+// Time of the last initialization in microseconds, and if it was a warm start.
+static uint32_t display_init_time = 0;
+static bool display_warm_start = false;
+
+// Function the next refresh waits for, and the time it took in milliseconds, see `displayHoldRefresh`.
+static void (*display_hold)() = NULL;
+static uint32_t display_hold_time = 0;
+
+/*
+    The frame buffer is kept in deep sleep with the display. If the frame
+    of the next minute is drawn ahead, these describe it, until an other
+    draw overwrites it. See `displayStartAhead`.
+*/
+static ClockValues RTC_DATA_ATTR display_ahead_values;
+static uint8_t RTC_DATA_ATTR display_ahead_fields = 0;
+
+
+/*
+    Areas of the clock face fields, in the order of their `CLOCK_FIELD_` bits.
+    The Y coordinates are multiples of 8, as the controller addresses the RAM
+    in whole bytes in that direction, so a window never reaches into an other area.
+*/
+static const struct { int16_t x, y, w, h; } display_clock_areas[CLOCK_FIELD_COUNT] = {
+    /* CLOCK_FIELD_HOUR           */ {   0,  16, 148, 88 },
+    /* CLOCK_FIELD_MINUTE         */ { 148,  16, 148, 88 },
+    /* CLOCK_FIELD_DATE           */ {   0, 104, 296, 24 },
+    /* CLOCK_FIELD_BATTERY        */ {   0,   0,  72, 16 },
+    /* CLOCK_FIELD_DAYS_REMAINING */ {  72,   0,  64, 16 },
+    /* CLOCK_FIELD_LAST_SYNC      */ { 232,   0,  64, 16 },
+};
 
 
 // --- Display Related Functions ---
@@ -12,8 +62,10 @@ GxEPD2_BW<GxEPD2_290_BS, GxEPD2_290_BS::HEIGHT> RTC_DATA_ATTR display(GxEPD2_290
 /// @param full If true, a full windows refresh is selected. If false, the refresh style has to be manually set after this.
 void displayStartDraw(bool fast, bool full) {
     
+    display_ahead_fields = 0;
     display.firstPage();
     display.setTextColor(GxEPD_BLACK);
+    display_partial_refresh = fast || !full;
     if (!full) return;
     if (fast) {
         display.setPartialWindow(0, 0, display.width(), display.height());
@@ -23,11 +75,107 @@ void displayStartDraw(bool fast, bool full) {
 
 }
 
+/// @brief Starts drawing the next frame into the buffer while the display is refreshing, in the same window.
+/// Has to be called from the busy callback, finish with `displayEndAhead`.
+/// @return False if no refresh is in progress, then nothing may be drawn.
+bool displayStartAhead() {
+
+    #if defined(VIRTUAL_DISPLAY)
+        return false;
+    #else
+        if (!display.epd2.keepImage()) return false;
+        display.firstPage();
+        display.setTextColor(GxEPD_BLACK);
+        return true;
+    #endif /* VIRTUAL_DISPLAY */
+
+}
+
+/// @brief Records the clock face drawn ahead.
+/// @param values The values of the clock face.
+/// @param fields The fields inside the window, as returned by `displaySetClockWindow`.
+void displayEndAhead(const ClockValues& values, uint8_t fields) {
+
+    display_ahead_values = values;
+    display_ahead_fields = fields;
+
+}
+
+/// @brief Checks if the buffer holds a clock face drawn ahead with the given values.
+/// @return The fields inside its window, or 0 if there is no such frame.
+uint8_t displayAheadFields(const ClockValues& values) {
+
+    if (display_ahead_fields == 0) return 0;
+    if (clockChangedFields(values, display_ahead_values) != 0) return 0;
+    return display_ahead_fields;
+
+}
+
+/// @brief Selects the window of the clock face drawn ahead, instead of starting a new draw.
+/// Refresh with `displayEndDraw`.
+/// @param fast If true, does a partial refresh. Has to be true, unless the whole frame was drawn ahead.
+/// @return The fields inside the window.
+uint8_t displayUseAhead(bool fast) {
+
+    const uint8_t fields = display_ahead_fields;
+    display_ahead_fields = 0;
+
+    display.setTextColor(GxEPD_BLACK);
+    display_partial_refresh = fast || (fields != CLOCK_FIELD_ALL);
+    if (fields != CLOCK_FIELD_ALL) {
+        displaySetClockWindow(fields);
+    } else if (fast) {
+        display.setPartialWindow(0, 0, display.width(), display.height());
+    } else {
+        display.setFullWindow();
+    }
+    return fields;
+
+}
+
+/// @brief Calls the function set by `displayHoldRefresh`, and measures the wait.
+static void displayRunHold() {
+
+    if (display_hold == NULL) return;
+    const uint32_t start_time = millis();
+    display_hold();
+    display_hold = NULL;
+    display_hold_time = millis() - start_time;
+
+}
+
+/// @brief Sets a function to wait for in the next refresh, after the image is loaded into the display.
+/// The refresh itself starts when it returns, so its timing does not depend on the render and the transfer.
+/// @param hold The function to call once.
+void displayHoldRefresh(void (*hold)()) {
+
+    display_hold = hold;
+    #if !defined(VIRTUAL_DISPLAY)
+        display.epd2.holdRefresh(displayRunHold);
+    #endif /* !VIRTUAL_DISPLAY */
+
+}
+
 /// @brief Refreshes the display.
 void displayEndDraw() {
 
+    // The virtual display has no separate load, it waits before the frame.
+    #if defined(VIRTUAL_DISPLAY)
+        displayRunHold();
+    #endif /* VIRTUAL_DISPLAY */
+
+    const uint32_t start_time = millis();
+    display_hold_time = 0;
     display.nextPage();
 
+    // Account for the time of the refresh, without the wait before it.
+    const uint32_t refresh_time = millis() - start_time - display_hold_time;
+    if (display_partial_refresh) {
+        display_partial_refresh_time += refresh_time;
+    } else {
+        display_full_refresh_time += refresh_time;
+    }
+
 }
 
 /// @brief Set the cursor, and print text to the display, such that the text is centered at the coordinates.
@@ -48,6 +196,70 @@ void displayCenterText(char* text, uint16_t x = 148, uint16_t y = 64, bool onlyC
 
 }
 
+/// @brief Draws a row of a compressed glyph, see `compress_font.py` for the format.
+/// @param data The run count of the row, followed by the runs.
+/// @param x The X coordinate of the left of the glyph.
+/// @param y The Y coordinate of the row.
+/// @return Pointer to the data after the row.
+static const uint8_t* displayDrawCompressedRow(const uint8_t* data, int16_t x, int16_t y) {
+
+    uint8_t runs = pgm_read_byte(data++);
+    while (runs >= 2) {
+        x += pgm_read_byte(data++);
+        const uint8_t black = pgm_read_byte(data++);
+        display.drawFastHLine(x, y, black, GxEPD_BLACK);
+        x += black;
+        runs -= 2;
+    }
+    return data + runs; // A trailing white run has nothing to draw.
+
+}
+
+/// @brief Prints text at the cursor with a run-length encoded font, without unpacking the glyphs.
+/// The font has to be set with `setFont` too, for the bounds of the text.
+/// @param font The compressed font, generated by `compress_font.py`.
+/// @param text The text to print.
+void displayPrintCompressed(const GFXfont* font, const char* text) {
+
+    const uint8_t* bitmap = (const uint8_t*)pgm_read_ptr(&font->bitmap);
+    const GFXglyph* glyphs = (const GFXglyph*)pgm_read_ptr(&font->glyph);
+    const uint8_t first = pgm_read_byte(&font->first);
+    const uint8_t last = pgm_read_byte(&font->last);
+
+    for (; *text; text++) {
+
+        if ((*text < first) || (*text > last)) continue;
+        const GFXglyph* glyph = glyphs + (*text - first);
+
+        // Runs are drawn straight into the frame buffer, row by row.
+        const uint8_t* data = bitmap + pgm_read_word(&glyph->bitmapOffset);
+        const uint8_t* last_row = data;
+        const int16_t x = display.getCursorX() + (int8_t)pgm_read_byte(&glyph->xOffset);
+        int16_t y = display.getCursorY() + (int8_t)pgm_read_byte(&glyph->yOffset);
+        const int16_t end = y + pgm_read_byte(&glyph->height);
+
+        while (y < end) {
+            const uint8_t header = pgm_read_byte(data);
+            if (header & 0x80) {
+
+                // Repeat the last row.
+                for (uint8_t i = 0; (i < (header & 0x7F)) && (y < end); i++) displayDrawCompressedRow(last_row, x, y++);
+                data++;
+
+            } else {
+
+                last_row = data;
+                data = displayDrawCompressedRow(data, x, y++);
+
+            }
+        }
+
+        display.setCursor(display.getCursorX() + pgm_read_byte(&glyph->xAdvance), display.getCursorY());
+
+    }
+
+}
+
 /// @brief Renders the visual borders of the screen.
 void displayRenderBorders() {
 
@@ -60,31 +272,49 @@ void displayRenderBorders() {
 
 /// @brief Renders the status bar on the top of the display.
 /// @param battery_value_buf Battery voltage in string format.
+/// @param days_remaining_buf Estimated days remaining in string format.
 /// @param last_sync_hour_buf Last sync hours in string format.
 /// @param last_sync_minute_buf Last sync minutes in string format.
-void displayRenderStatusBar(char* battery_value_buf, char* last_sync_hour_buf, char* last_sync_minute_buf, uint8_t battery_status) {
+/// @param battery_status Index of the battery icon.
+/// @param fields Mask of the `CLOCK_FIELD_` bits to render, the others are skipped.
+void displayRenderStatusBar(char* battery_value_buf, char* days_remaining_buf, char* last_sync_hour_buf, char* last_sync_minute_buf, uint8_t battery_status, uint8_t fields) {
 
     display.setFont(&FreeMonoBold9pt7b);
 
-    display.drawXBitmap(0, 1, battery_multiple_xbm_bits[battery_status], battery_xbm_width, battery_xbm_height, GxEPD_BLACK);
-    displayCenterText(battery_value_buf, 40, 6);
-
-    display.drawXBitmap(236, 0, refresh_xbm_bits, refresh_xbm_width, refresh_xbm_height, GxEPD_BLACK);
-    displayCenterText(last_sync_hour_buf, 260, 6);
-    displayCenterText((char*)":", 273, 6);
-    displayCenterText(last_sync_minute_buf, 286, 6);
+    if (fields & CLOCK_FIELD_BATTERY) {
+        display.drawXBitmap(0, 1, battery_multiple_xbm_bits[battery_status], battery_xbm_width, battery_xbm_height, GxEPD_BLACK);
+        displayCenterText(battery_value_buf, 40, 6);
+    }
+    if (fields & CLOCK_FIELD_DAYS_REMAINING) {
+        displayCenterText(days_remaining_buf, 96, 6);
+    }
+    if (fields & CLOCK_FIELD_LAST_SYNC) {
+        display.drawXBitmap(236, 0, refresh_xbm_bits, refresh_xbm_width, refresh_xbm_height, GxEPD_BLACK);
+        displayCenterText(last_sync_hour_buf, 260, 6);
+        displayCenterText((char*)":", 273, 6);
+        displayCenterText(last_sync_minute_buf, 286, 6);
+    }
 
 }
 
 /// @brief Renders the time to the center of the display.
 /// @param hour_buf Hours in string format.
 /// @param minute_buf Minutes in string format.
-void displayRenderTime(char* hour_buf, char* minute_buf) {
-
-    display.setFont(&FreeMonoBold48pt7b);
-    displayCenterText(hour_buf, 74, 62);
-    displayCenterText((char*)":", 148, 62);
-    displayCenterText(minute_buf, 222, 62);
+/// @param fields Mask of the `CLOCK_FIELD_` bits to render, the colon is always rendered.
+void displayRenderTime(char* hour_buf, char* minute_buf, uint8_t fields) {
+
+    // The large font is compressed, GFX only measures it.
+    display.setFont(&FreeMonoBold48pt7bRle);
+    if (fields & CLOCK_FIELD_HOUR) {
+        displayCenterText(hour_buf, 74, 62, true);
+        displayPrintCompressed(&FreeMonoBold48pt7bRle, hour_buf);
+    }
+    displayCenterText((char*)":", 148, 62, true);
+    displayPrintCompressed(&FreeMonoBold48pt7bRle, ":");
+    if (fields & CLOCK_FIELD_MINUTE) {
+        displayCenterText(minute_buf, 222, 62, true);
+        displayPrintCompressed(&FreeMonoBold48pt7bRle, minute_buf);
+    }
 
 }
 
@@ -101,9 +331,103 @@ void displayRenderDate(char* date_buf) {
 /// @param seconds Seconds in integer format.
 void displayRenderSecond(uint8_t seconds) {
 
+    char second_buf[3];
+    clockFormatDigits(second_buf, seconds, 2);
+
     display.setFont(&FreeMonoBold12pt7b);
     displayCenterText((char*)"00", 148, 28, true);
-    display.printf("%02d", seconds);
+    display.print(second_buf);
+
+}
+
+/// @brief Selects a partial window covering only the seconds over the large colon.
+/// Has to be called after starting a draw with `full` set to false.
+void displaySetSecondWindow() {
+
+    // Get the bounding box of the widest possible seconds text.
+    int16_t tbx, tby; uint16_t tbw, tbh;
+    display.setFont(&FreeMonoBold12pt7b);
+    displayCenterText((char*)"00", 148, 28, true);
+    display.getTextBounds((char*)"00", display.getCursorX(), display.getCursorY(), &tbx, &tby, &tbw, &tbh);
+
+    // Only this area is sent to, and refreshed on the display.
+    display.setPartialWindow(tbx, tby, tbw, tbh);
+
+}
+
+/// @brief Selects a partial window covering the areas of some clock face fields.
+/// Has to be called after starting a draw with `full` set to false.
+/// @param fields Mask of the `CLOCK_FIELD_` bits to cover.
+/// @return Mask of every field inside the window, these have to be rendered.
+uint8_t displaySetClockWindow(uint8_t fields) {
+
+    int16_t x1, y1, x2, y2;
+    uint8_t inside = fields;
+    do {
+
+        // Bounding box of the selected areas.
+        fields = inside;
+        x1 = display.width(); y1 = display.height(); x2 = 0; y2 = 0;
+        for (uint8_t i = 0; i < CLOCK_FIELD_COUNT; i++) {
+            if (!(fields & (1 << i))) continue;
+            x1 = min(x1, display_clock_areas[i].x);
+            y1 = min(y1, display_clock_areas[i].y);
+            x2 = max(x2, (int16_t)(display_clock_areas[i].x + display_clock_areas[i].w));
+            y2 = max(y2, (int16_t)(display_clock_areas[i].y + display_clock_areas[i].h));
+        }
+
+        // Fields partly inside the box would be cleared, so the box is grown to cover them whole.
+        inside = 0;
+        for (uint8_t i = 0; i < CLOCK_FIELD_COUNT; i++) {
+            if ((display_clock_areas[i].x < x2) && (display_clock_areas[i].x + display_clock_areas[i].w > x1) &&
+                (display_clock_areas[i].y < y2) && (display_clock_areas[i].y + display_clock_areas[i].h > y1)) inside |= (1 << i);
+        }
+
+    } while (inside != fields);
+
+    // The same fields always give the same window, so a frame drawn ahead matches it.
+    display.setPartialWindow(x1, y1, x2 - x1, y2 - y1);
+    return inside;
+
+}
+
+/// @brief Renders the elapsed time of the stopper to the center of the display.
+/// @param elapsed_ms Elapsed time in milliseconds.
+/// @param precise If true, hundredths of seconds are also shown.
+void displayRenderStopper(uint32_t elapsed_ms, bool precise) {
+
+    char stopper_buf[12];
+    clockFormatStopper(stopper_buf, elapsed_ms, precise);
+
+    display.setFont(&FreeMonoBold24pt7b);
+    displayCenterText(stopper_buf);
+
+}
+
+/// @brief Renders the last result of the stopper to the bottom of the display.
+/// @param elapsed_ms Elapsed time in milliseconds.
+void displayRenderStopperLast(uint32_t elapsed_ms) {
+
+    char stopper_buf[20] = "LAST ";
+    clockFormatStopper(stopper_buf + 5, elapsed_ms, true);
+
+    display.setFont(&FreeMonoBold12pt7b);
+    displayCenterText(stopper_buf, 148, 114);
+
+}
+
+/// @brief Selects a partial window covering only the elapsed time of the stopper.
+/// Has to be called after starting a draw with `full` set to false.
+void displaySetStopperWindow() {
+
+    // Get the bounding box of the widest possible stopper text.
+    int16_t tbx, tby; uint16_t tbw, tbh;
+    display.setFont(&FreeMonoBold24pt7b);
+    displayCenterText((char*)"00:00.00", 148, 64, true);
+    display.getTextBounds((char*)"00:00.00", display.getCursorX(), display.getCursorY(), &tbx, &tby, &tbw, &tbh);
+
+    // Only this area is sent to, and refreshed on the display.
+    display.setPartialWindow(tbx, tby, tbw, tbh);
 
 }
 
@@ -157,14 +481,65 @@ void displayRenderCriticalMessage() {
 /// @param wipe If true, does an initial wipe.
 void displayInit(bool wipe) {
 
+    const int64_t start_time = esp_timer_get_time();
+
+    // A display left in deep sleep by the last boot only has to be woken up, see `display_driver.h`.
+    // Without its own power, the controller loses everything between boots.
+    #if defined(WARM_DISPLAY_INIT) && !defined(AUX_FOR_DISP)
+        display_warm_start = display_hibernated && !wipe;
+    #endif /* WARM_DISPLAY_INIT && !AUX_FOR_DISP */
+    display_hibernated = false;
+
+    // Image data is streamed at the highest clock of the controller, see `display_driver.h`.
+    #if !defined(VIRTUAL_DISPLAY)
+        display.epd2.selectSPI(SPI, SPISettings(DISPLAY_SPI_FREQUENCY, MSBFIRST, SPI_MODE0));
+        display.epd2.warm_start = display_warm_start;
+    #endif /* !VIRTUAL_DISPLAY */
+
     display.init(115200, wipe, 2, false);
     display.setRotation(3); // Landscape with the connector on the left
 
+    display_init_time = esp_timer_get_time() - start_time;
+
+}
+
+/// @brief Sets the function called repeatedly while the display is busy with a refresh.
+/// @param callback The function, it should return soon after the BUSY pin is released.
+void displaySetBusyCallback(void (*callback)(const void*)) {
+
+    #if !defined(VIRTUAL_DISPLAY)
+        display.epd2.setBusyCallback(callback);
+    #endif /* !VIRTUAL_DISPLAY */
+
 }
 
 /// @brief Hibernates the display.
 void displayHibernate() {
 
     display.hibernate();
+    display_hibernated = true;
+
+}
+
+/// @brief Gets the time of the last initialization of the display.
+/// The controller setup of a cold start is done on the first image write, so it is counted in `displayWriteTime`.
+/// @param warm Set to true if it was a warm start.
+/// @return The time in microseconds.
+uint32_t displayInitTime(bool& warm) {
+
+    warm = display_warm_start;
+    return display_init_time;
+
+}
+
+/// @brief Gets the time spent writing images to the display controller.
+/// @return The time in microseconds since the start, 0 with the virtual display.
+uint32_t displayWriteTime() {
+
+    #if defined(VIRTUAL_DISPLAY)
+        return 0;
+    #else
+        return display.epd2.write_time;
+    #endif /* VIRTUAL_DISPLAY */
 
 }
\ No newline at end of file
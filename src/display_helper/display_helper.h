@@ -4,32 +4,62 @@
 #include <Arduino.h>
 
 // --- Settings and Pins ---
+#include "settings.h"
 #include "pins.h"
 
+// --- Display Driver ---
+#if defined(VIRTUAL_DISPLAY)
+    #include "virtual_display.h"
+#else
+    #include "display_driver.h"
+#endif /* VIRTUAL_DISPLAY */
+
 // --- Fonts ---
-#include "custom_fonts/FreeMonoBold48pt7b.h"
-#include <Fonts/FreeMonoBold24pt7b.h>
-#include <Fonts/FreeMonoBold12pt7b.h>
-#include <Fonts/FreeMonoBold9pt7b.h>
+// Subsets with only the used glyphs, generated before the build by `build_fonts.py`.
+#include "custom_fonts/generated/FreeMonoBold48pt7bRle.h"
+#include "custom_fonts/generated/FreeMonoBold24pt7b.h"
+#include "custom_fonts/generated/FreeMonoBold12pt7b.h"
+#include "custom_fonts/generated/FreeMonoBold9pt7b.h"
 
 // --- Icons ---
 #include "custom_icons.h"
 
+// --- Clock Face Fields ---
+#include "clock_format/clock_format.h"
+
+// --- Refresh Statistics ---
+extern uint32_t display_full_refresh_time;
+extern uint32_t display_partial_refresh_time;
+
 // --- Functions ---
 void displayStartDraw(bool fast = false, bool full = true);
 void displayEndDraw();
+void displayHoldRefresh(void (*hold)());
+bool displayStartAhead();
+void displayEndAhead(const ClockValues& values, uint8_t fields);
+uint8_t displayAheadFields(const ClockValues& values);
+uint8_t displayUseAhead(bool fast);
 
 void displayCenterText(char* text, uint16_t x, uint16_t y, bool onlyCursor = false);
+void displayPrintCompressed(const GFXfont* font, const char* text);
 
 void displayRenderBorders();
-void displayRenderStatusBar(char* battery_value_buf, char* last_sync_hour_buf, char* last_sync_minute_buf, uint8_t battery_status);
-void displayRenderTime(char* hour_buf, char* minute_buf);
+void displayRenderStatusBar(char* battery_value_buf, char* days_remaining_buf, char* last_sync_hour_buf, char* last_sync_minute_buf, uint8_t battery_status, uint8_t fields = CLOCK_FIELD_ALL);
+void displayRenderTime(char* hour_buf, char* minute_buf, uint8_t fields = CLOCK_FIELD_ALL);
 void displayRenderDate(char* date_buf);
+uint8_t displaySetClockWindow(uint8_t fields);
 void displayRenderSecond(uint8_t seconds);
+void displaySetSecondWindow();
+void displayRenderStopper(uint32_t elapsed_ms, bool precise);
+void displayRenderStopperLast(uint32_t elapsed_ms);
+void displaySetStopperWindow();
 void displayRenderFlag(char* text);
 void displayRenderClaim(char* text);
 void displayRenderUpdateMessage();
 void displayRenderCriticalMessage();
 
 void displayInit(bool wipe);
+void displaySetBusyCallback(void (*callback)(const void*));
 void displayHibernate();
+uint32_t displayInitTime(bool& warm);
+uint32_t displayWriteTime();
@@ -0,0 +1,171 @@
+#include "virtual_display.h"
+
+
+// --- Constants ---
+#define VIRTUAL_DISPLAY_WHITE 0xFFFF
+
+
+// --- Construction ---
+
+/// @brief Creates a virtual display.
+/// @param width Width of the panel in pixels, without rotation.
+/// @param height Height of the panel in pixels, without rotation.
+/// @param output Where the images of the refreshes are written to.
+VirtualDisplay::VirtualDisplay(int16_t width, int16_t height, Print& output) :
+    Adafruit_GFX(width, height), _output(output) {
+
+    _buffer = (uint8_t*)malloc(WIDTH / 8 * HEIGHT);
+    _panel = (uint8_t*)malloc(WIDTH / 8 * HEIGHT);
+    memset(_panel, 0xFF, WIDTH / 8 * HEIGHT);
+
+    full_refreshes = 0;
+    partial_refreshes = 0;
+    spi_bytes = 0;
+    pixels_written = 0;
+    setFullWindow();
+
+}
+
+
+// --- GxEPD2 Interface ---
+
+/// @brief Initializes the display. The panel is wiped if `initial` is set.
+void VirtualDisplay::init(uint32_t serial_diag_bitrate, bool initial, uint16_t reset_duration, bool pulldown_rst_mode) {
+
+    if (initial) memset(_panel, 0xFF, WIDTH / 8 * HEIGHT);
+
+}
+
+/// @brief Selects a full refresh of the whole panel.
+void VirtualDisplay::setFullWindow() {
+
+    _using_partial_mode = false;
+    _pw_x = 0;
+    _pw_y = 0;
+    _pw_w = WIDTH;
+    _pw_h = HEIGHT;
+
+}
+
+/// @brief Selects a partial refresh of a window, given in rotated coordinates.
+void VirtualDisplay::setPartialWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+
+    _pw_x = min((int16_t)x, width());
+    _pw_y = min((int16_t)y, height());
+    _pw_w = min((int16_t)w, (int16_t)(width() - _pw_x));
+    _pw_h = min((int16_t)h, (int16_t)(height() - _pw_y));
+    rotateWindow(_pw_x, _pw_y, _pw_w, _pw_h);
+    _using_partial_mode = true;
+
+    // The controller addresses the RAM in whole bytes, as GxEPD2 does.
+    _pw_w += _pw_x % 8;
+    if (_pw_w % 8 > 0) _pw_w += 8 - _pw_w % 8;
+    _pw_x -= _pw_x % 8;
+
+}
+
+/// @brief Starts drawing a frame on a white background.
+void VirtualDisplay::firstPage() {
+
+    memset(_buffer, 0xFF, WIDTH / 8 * HEIGHT);
+
+}
+
+/// @brief Refreshes the window with the frame, and writes the image of the panel to the output.
+/// @return Always false, as the whole frame fits into one page.
+bool VirtualDisplay::nextPage() {
+
+    // Only the window is transferred to the panel.
+    for (int16_t y = _pw_y; y < _pw_y + _pw_h; y++) {
+        memcpy(_panel + (y * WIDTH + _pw_x) / 8, _buffer + (y * WIDTH + _pw_x) / 8, _pw_w / 8);
+    }
+
+    // Both RAM buffers of the controller are written.
+    spi_bytes += 2 * (_pw_w / 8) * _pw_h;
+    if (_using_partial_mode) {
+        partial_refreshes++;
+    } else {
+        full_refreshes++;
+    }
+
+    writeFrame();
+    return false;
+
+}
+
+/// @brief Hibernates the display. The image stays on the panel.
+void VirtualDisplay::hibernate() {
+
+}
+
+
+// --- Drawing ---
+
+/// @brief Draws a pixel of the frame, pixels outside of the window are ignored.
+void VirtualDisplay::drawPixel(int16_t x, int16_t y, uint16_t color) {
+
+    pixels_written++;
+    if ((x < 0) || (x >= width()) || (y < 0) || (y >= height())) return;
+
+    // Rotate to panel coordinates, as GxEPD2 does.
+    switch (getRotation()) {
+        case 1: { int16_t t = x; x = y; y = t; x = WIDTH - x - 1; break; }
+        case 2: x = WIDTH - x - 1; y = HEIGHT - y - 1; break;
+        case 3: { int16_t t = x; x = y; y = t; y = HEIGHT - y - 1; break; }
+    }
+
+    if ((x < _pw_x) || (x >= _pw_x + _pw_w) || (y < _pw_y) || (y >= _pw_y + _pw_h)) return;
+
+    const uint16_t i = (x + y * WIDTH) / 8;
+    if (color == VIRTUAL_DISPLAY_WHITE) {
+        _buffer[i] |= (1 << (7 - x % 8));
+    } else {
+        _buffer[i] &= ~(1 << (7 - x % 8));
+    }
+
+}
+
+
+// --- Helper Functions ---
+
+/// @brief Rotates a window from the drawing coordinates to the coordinates of the panel.
+void VirtualDisplay::rotateWindow(int16_t& x, int16_t& y, int16_t& w, int16_t& h) {
+
+    int16_t t;
+    switch (getRotation()) {
+        case 1: t = x; x = y; y = t; t = w; w = h; h = t; x = WIDTH - x - w; break;
+        case 2: x = WIDTH - x - w; y = HEIGHT - y - h; break;
+        case 3: t = x; x = y; y = t; t = w; w = h; h = t; y = HEIGHT - y - h; break;
+    }
+
+}
+
+/// @brief Reads a pixel of the panel, in drawing coordinates.
+/// @return True if the pixel is black.
+bool VirtualDisplay::getPixel(int16_t x, int16_t y) {
+
+    int16_t w = 1, h = 1;
+    rotateWindow(x, y, w, h);
+    return !(_panel[(x + y * WIDTH) / 8] & (1 << (7 - x % 8)));
+
+}
+
+/// @brief Writes the image of the panel as a binary PBM, as it is seen after the rotation.
+void VirtualDisplay::writeFrame() {
+
+    _output.printf("P4\n# refresh=%s window=%d,%d,%d,%d spi=%u\n%d %d\n",
+        _using_partial_mode ? "partial" : "full", _pw_x, _pw_y, _pw_w, _pw_h,
+        (unsigned)(2 * (_pw_w / 8) * _pw_h), width(), height());
+
+    // Rows are padded to whole bytes, a set bit is black.
+    for (int16_t y = 0; y < height(); y++) {
+        for (int16_t x = 0; x < width(); x += 8) {
+            uint8_t byte = 0;
+            for (int16_t b = 0; (b < 8) && (x + b < width()); b++) {
+                if (getPixel(x + b, y)) byte |= (1 << (7 - b));
+            }
+            _output.write(byte);
+        }
+    }
+
+}
@@ -0,0 +1,65 @@
+#ifndef VIRTUAL_DISPLAY_H
+#define VIRTUAL_DISPLAY_H
+
+// --- Libraries ---
+#include <Adafruit_GFX.h>
+#include <Arduino.h>
+
+
+// --- Virtual Display ---
+
+/*
+    A stand-in for `GxEPD2_BW`, implementing the part of its interface
+    used by `display_helper`. Drawing is done by Adafruit GFX, the same
+    way as on the real panel, but instead of sending the frame over SPI,
+    every refresh is written to the output as a binary PBM image.
+
+    The header of each image has a comment describing the refresh:
+        # refresh=<full|partial> window=<x>,<y>,<w>,<h> spi=<bytes>
+    The window is in the unrotated coordinates of the panel, after the
+    same rounding to whole bytes that GxEPD2 does. The SPI byte count is
+    the image data the driver would send, both controller RAM buffers
+    are written, as on the `GxEPD2_290_BS`.
+
+    Enable with the `VIRTUAL_DISPLAY` option in `settings.h`, and capture
+    the images from the serial port. The host tests compare the images to
+    golden ones, see `test/test_virtual_display`.
+*/
+class VirtualDisplay : public Adafruit_GFX {
+
+public:
+
+    VirtualDisplay(int16_t width, int16_t height, Print& output);
+
+    // Part of the `GxEPD2_BW` interface.
+    void init(uint32_t serial_diag_bitrate, bool initial, uint16_t reset_duration, bool pulldown_rst_mode);
+    void setFullWindow();
+    void setPartialWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+    void firstPage();
+    bool nextPage();
+    void hibernate();
+
+    // Drawing, see Adafruit GFX.
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+
+    // Statistics of the refreshes since the start.
+    uint32_t full_refreshes;
+    uint32_t partial_refreshes;
+    uint32_t spi_bytes;
+    uint32_t pixels_written;
+
+private:
+
+    void rotateWindow(int16_t& x, int16_t& y, int16_t& w, int16_t& h);
+    bool getPixel(int16_t x, int16_t y);
+    void writeFrame();
+
+    Print& _output;
+    uint8_t* _buffer;   // The frame being drawn, in panel coordinates.
+    uint8_t* _panel;    // The image on the panel, in panel coordinates.
+    bool _using_partial_mode;
+    int16_t _pw_x, _pw_y, _pw_w, _pw_h;
+
+};
+
+#endif /* VIRTUAL_DISPLAY_H */
@@ -0,0 +1,105 @@
+#include "energy_ledger.h"
+
+#include "rtc_state/rtc_state.h"
+
+
+/*
+    The ledger keeps track of the charge drawn from the battery.
+    Every boot is charged with a modelled cost of its phases, using the
+    currents in `settings.h`. All charges are in microcoulombs, as
+    milliamps multiplied by milliseconds, or microamps multiplied by
+    seconds, both give microcoulombs.
+
+    When the battery voltage is measured, the ledger is reconciled:
+    the state of charge predicted by the ledger is blended with the one
+    derived from the voltage, and the average daily consumption is
+    updated, which gives the estimated days remaining.
+
+    The time of the period is counted in seconds, the milliseconds left
+    over are carried to the next boot, so the short boots add up.
+*/
+
+
+// --- Constants ---
+#define MICROCOULOMBS_PER_MAH   3600000ULL
+#define SECONDS_PER_DAY         86400ULL
+
+
+// --- Ledger Functions ---
+
+/// @brief Charges the ledger with the modelled cost of the current boot, and the following deep sleep.
+/// @param awake_ms The time spent awake in this boot, in milliseconds.
+/// @param wifi_ms The time WiFi was turned on, in milliseconds.
+/// @param adc_sampled True if the battery voltage was measured.
+/// @param full_refresh_ms The time spent waiting for full refreshes, in milliseconds.
+/// @param partial_refresh_ms The time spent waiting for partial refreshes, in milliseconds.
+/// @param sleep_us The length of the following deep sleep, in microseconds.
+void ledgerChargeBoot(uint32_t awake_ms, uint32_t wifi_ms, bool adc_sampled,
+    uint32_t full_refresh_ms, uint32_t partial_refresh_ms, uint64_t sleep_us) {
+
+    uint32_t charge = 0;
+    charge += (awake_ms + POWER_BOOT_TIME) * POWER_AWAKE_CURRENT;
+    charge += wifi_ms * POWER_WIFI_CURRENT;
+    charge += full_refresh_ms * POWER_FULL_REFRESH_CURRENT;
+    charge += partial_refresh_ms * POWER_PARTIAL_REFRESH_CURRENT;
+    charge += (uint32_t)(sleep_us * POWER_SLEEP_CURRENT / 1000000);
+    if (adc_sampled) charge += POWER_ADC_CHARGE;
+
+    rtc_state.ledger_charge += charge;
+
+    const uint64_t elapsed_ms = rtc_state.ledger_remainder_ms + awake_ms + POWER_BOOT_TIME + sleep_us / 1000;
+    rtc_state.ledger_seconds += elapsed_ms / 1000;
+    rtc_state.ledger_remainder_ms = elapsed_ms % 1000;
+
+}
+
+/// @brief Reconciles the ledger with a voltage based measurement, and updates the estimates.
+/// @param voltage_percent The battery percent derived from the voltage.
+/// @return The reconciled state of charge in percent.
+uint8_t ledgerReconcile(uint8_t voltage_percent) {
+
+    const int32_t voltage_soc = (int32_t)voltage_percent * 10;
+    const uint64_t capacity = (uint64_t)BATTERY_CAPACITY * MICROCOULOMBS_PER_MAH;
+
+    // State of charge predicted by the ledger, in permille.
+    const int32_t ledger_soc = (int32_t)rtc_state.ledger_soc - (int32_t)((uint64_t)rtc_state.ledger_charge * 1000 / capacity);
+
+    if (rtc_state.ledger_seconds == 0 || (voltage_soc - ledger_soc) > POWER_REANCHOR_THRESHOLD * 10) {
+
+        // After a reset, or if the battery was charged or replaced, start over from the voltage.
+        rtc_state.ledger_soc = voltage_soc;
+
+    } else {
+
+        // Blend the two estimates. The voltage corrects the drift of the model.
+        int32_t soc = ledger_soc + (voltage_soc - ledger_soc) * POWER_VOLTAGE_WEIGHT / 100;
+        if (soc < 0) soc = 0;
+        if (soc > 1000) soc = 1000;
+        rtc_state.ledger_soc = soc;
+
+        // Update the average daily consumption.
+        const uint32_t daily_charge = (uint64_t)rtc_state.ledger_charge * SECONDS_PER_DAY / rtc_state.ledger_seconds;
+        const uint32_t daily_charge_history_weight = 3;
+        if (rtc_state.ledger_daily_charge == 0) {
+            rtc_state.ledger_daily_charge = daily_charge;
+        } else {
+            rtc_state.ledger_daily_charge = (daily_charge + rtc_state.ledger_daily_charge * daily_charge_history_weight) / (daily_charge_history_weight + 1);
+        }
+
+    }
+
+    // Estimate the remaining days from the average consumption.
+    if (rtc_state.ledger_daily_charge == 0) {
+        rtc_state.ledger_days_remaining = LEDGER_DAYS_UNKNOWN;
+    } else {
+        const uint64_t days = capacity * rtc_state.ledger_soc / 1000 / rtc_state.ledger_daily_charge;
+        rtc_state.ledger_days_remaining = (days < LEDGER_DAYS_UNKNOWN) ? days : LEDGER_DAYS_UNKNOWN - 1;
+    }
+
+    // Start a new period.
+    rtc_state.ledger_charge = 0;
+    rtc_state.ledger_seconds = 0;
+
+    return (rtc_state.ledger_soc + 5) / 10;
+
+}
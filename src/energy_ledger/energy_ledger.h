@@ -0,0 +1,18 @@
+#ifndef ENERGY_LEDGER_H
+#define ENERGY_LEDGER_H
+
+// --- Libraries ---
+#include <Arduino.h>
+
+// --- Settings ---
+#include "settings.h"
+
+// --- Constants ---
+#define LEDGER_DAYS_UNKNOWN 0xFFFF
+
+// --- Functions ---
+void ledgerChargeBoot(uint32_t awake_ms, uint32_t wifi_ms, bool adc_sampled,
+    uint32_t full_refresh_ms, uint32_t partial_refresh_ms, uint64_t sleep_us);
+uint8_t ledgerReconcile(uint8_t voltage_percent);
+
+#endif /* ENERGY_LEDGER_H */
@@ -4,80 +4,92 @@
 
 // --- Libraries ---
 #include <Arduino.h>
-#include <WiFi.h>
-#include <HTTPClient.h>
 
-#include <esp_sntp.h>
-#include <esp_adc_cal.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <driver/gpio.h>
 
 
 // --- Settings and Pins ---
 #include "settings.h"
 #include "pins.h"
-#include "wifi_secret.h"
 
 
 // --- Components ---
 #include "display_helper/display_helper.h"
+#include "rtc_state/rtc_state.h"
+#include "battery_helper/battery_helper.h"
+#include "energy_ledger/energy_ledger.h"
+#include "boot_mode/boot_mode.h"
+#include "mode_switch/mode_switch.h"
+#include "render_benchmark/render_benchmark.h"
+#include "wifi_sync/wifi_sync.h"
+#include "task_graph/task_graph.h"
+#include "time_zone/time_zone.h"
+#include "clock_format/clock_format.h"
 
 
 // --- Calculated Constants ---
 const TickType_t loop_tick_delay = LOOP_WAIT_TIME / portTICK_PERIOD_MS;
+const uint64_t button_wakeup_mask = (1ULL << BTN_TOP_PIN_NUM) + (1ULL << BTN_BOTTOM_PIN_NUM);
 
 
-// --- Mode Numbering ---
-#define NULL_MODE     0b00000000
-#define RESET_MODE    0b00000001
-#define NORMAL_MODE   0b00000010
-#define RESYNC_MODE   0b00000100
-#define SECONDS_MODE  0b00001000
-#define STOPPER_MODE  0b00010000
-#define UPDATE_MODE   0b00100000
-#define CRITICAL_MODE 0b01000000
+// --- Battery Status Numbering ---
+#define BATTERY_STATUS_CHARGING 4
 
 // --- Global Variables ---
 
-// Mode variables, and counters in RTC memory
-uint8_t RTC_NOINIT_ATTR desired_mode = NULL_MODE;
-uint8_t RTC_NOINIT_ATTR mode = NULL_MODE;
-uint32_t RTC_NOINIT_ATTR boot_num = 0;
-
-// Last sync variables in RTC memory
-uint8_t RTC_NOINIT_ATTR last_sync_minute;
-uint8_t RTC_NOINIT_ATTR last_sync_hour;
-char RTC_NOINIT_ATTR strf_last_sync_hour_buf[3];
-char RTC_NOINIT_ATTR strf_last_sync_minute_buf[3];
-
-// Time shift compensation variables in RTC memory
-int32_t RTC_NOINIT_ATTR time_shift_average;
-int32_t RTC_NOINIT_ATTR time_shift_samples;
-
-int32_t RTC_NOINIT_ATTR time_correction_step;
-
-int32_t RTC_NOINIT_ATTR time_deviation_average;
-int32_t RTC_NOINIT_ATTR time_deviation_samples;
-
-// Battery variable in RTC memory
-char RTC_NOINIT_ATTR strf_battery_value_buf[8];
-uint8_t RTC_NOINIT_ATTR battery_status;
-
-// Wifi strength in RTC memory
-int8_t RTC_NOINIT_ATTR wifi_strength;
-
 // Time related variables
 time_t now;
 struct tm timeinfo;
 struct timeval tv_now;
 
-// String buffers
-char strf_hour_buf[3];
-char strf_minute_buf[3];
-char strf_date_buf[16];
+// Clock face, its texts, and the fields that differ from the display
+ClockValues clock_values;
+ClockStrings clock_strings;
+uint8_t clock_changed;
+
+// Rendering ahead, the window fields of the refresh in progress, and times in microseconds
+uint8_t render_ahead_fields = 0;
+uint32_t render_time = 0;
+uint32_t render_ahead_time = 0;
+
+// Start of the minute on the clock face, and how late its refresh started in microseconds
+time_t refresh_minute;
+uint32_t refresh_lag = 0;
 
 // Loop status
 bool loop_running;
 bool fast_refresh;
 
+// Button to mode latency in microseconds for the boot profile, see `profileModeSwitch`.
+int64_t mode_request_us = 0;
+int64_t mode_switch_us = 0;
+bool mode_requested = false;
+
+// Buttons that also end the light sleep of a refresh, and the time of their press, see `displayBusySleep`.
+uint64_t busy_wakeup_mask = 0;
+int64_t busy_press_us = 0;
+
+// Power accounting
+uint32_t wifi_time = 0;
+uint32_t battery_voltage = 0;
+
+// Sync state, the WiFi is started by a boot step, see `stepWifi`.
+bool wifi_on = false;
+uint32_t wifi_start_time;
+int64_t sync_time_before_ms;
+
+// Display state, set before the boot steps.
+bool display_wipe;
+
+// Set if the Arduino runtime initialization was skipped, see `__wrap_initArduino`.
+bool fast_boot = false;
+bool runtime_initialized = false;
+
+// Interrupts attached to the buttons, so they can be called after a light sleep wakeup
+void (*button_interrupts[NUM_DIGITAL_PINS])() = { NULL };
+
 
 // --- Function Declarations ---
 
@@ -85,128 +97,129 @@ bool fast_refresh;
 // Interrupt functions.
 void IRAM_ATTR intUpdateMode();
 void IRAM_ATTR intSecondsMode();
+void IRAM_ATTR intStopperMode();
 void IRAM_ATTR intNormalMode();
 void IRAM_ATTR intLoopStop();
 void IRAM_ATTR sntpSyncCallback(timeval *tv);
 
 // Time related functions.
 void getTime();
+uint32_t getTimePrecise();
 void formatStrings();
-void configureTimeZone();
+void renderClockFace(ClockStrings& strings, const ClockValues& values, uint8_t fields);
+void renderAhead();
 void adjustTime(int32_t offset);
 
+// Sleep and button related functions.
+bool lightSleep(uint64_t time_us, uint64_t pin_mask);
+void displayBusySleep(const void* parameter);
+void waitForRefreshMinute();
+void waitForButtonRelease();
+void attachButtonInterrupt(uint8_t pin, void (*isr)());
+void detachButtonInterrupt(uint8_t pin);
+void attachModeInterrupts();
+uint8_t switchToPendingMode();
+uint8_t getBootWakes(esp_reset_reason_t reset_cause);
+BootModeInputs getBootModeInputs(esp_reset_reason_t reset_cause, bool charging);
+bool fastBootPossible();
+void profileModeSwitch(int64_t request_us);
+void profileModeRefresh();
+
+// Fast boot.
+extern "C" void __real_initArduino();
+void fastBootTask(void* parameter);
+void fastBootInitRuntime(uint16_t phases);
+
+// Boot steps.
+void stepMeasure();
+void stepWifi();
+void stepTimeZone();
+void stepDisplay();
+
+
+// --- Boot Steps ---
+
+/*
+    The steps before the modes, and the steps each of them waits for.
+    Indices are the bits of the dependency masks.
+*/
+#define STEP_MEASURE    0
+#define STEP_WIFI       1
+#define STEP_TIME_ZONE  2
+#define STEP_DISPLAY    3
+#define STEP_COUNT      4
+
+const TaskGraphNode boot_steps[STEP_COUNT] = {
+    /* STEP_MEASURE   */ { "measure",   stepMeasure,  0 },
+    /* STEP_WIFI      */ { "wifi",      stepWifi,     1 << STEP_MEASURE },
+    /* STEP_TIME_ZONE */ { "time_zone", stepTimeZone, 0 },
+    /* STEP_DISPLAY   */ { "display",   stepDisplay,  0 },
+};
+TaskGraphRecord boot_step_records[STEP_COUNT];
+TaskGraphResult boot_steps_result;
+
 
 // --- Code ---
 void setup() {
 
+    // The application timer starts before `setup()`, so this is the time it took to get here.
+    #if defined(BOOT_PROFILE)
+        const int64_t setup_start_us = esp_timer_get_time();
+        const uint32_t setup_start_heap = esp_get_free_heap_size();
+    #endif /* BOOT_PROFILE */
+
 
     // --- Getting the Mode ---
 
 
-    /*     
-        To request modes, and store previous modes, and date from before resets,
-        RTC FAST memory is used. Variables labelled with `RTC_NOINIT_ATTR` are
-        store in RTC FAST memory, and as the "NOINIT" port suggest, are not
-        cleared on resets.
-        (As opposed to `RTC_DATA_ATTR`, witch only persists after deep sleep.)
+    /*
+        To request modes, and store previous modes, and data from before resets,
+        the persistent state block in RTC FAST memory is used.
+        See `rtc_state.h` for details.
 
         To filter mangled data after a power on reset - or crash -
-        the variables are cleared unless a soft reset or wakeup occurred.
+        the block is wiped unless a soft reset or wakeup occurred.
+        Otherwise, it is still wiped if its layout version or checksum does
+        not match, for example after flashing a firmware with a new layout.
     */
     
     // Get the reason of the reset.
     const esp_reset_reason_t reset_cause = esp_reset_reason();
 
-    // If we were not soft reset, or woken up from deep sleep, we have to wipe some variables.
-    if ((reset_cause != ESP_RST_DEEPSLEEP) && (reset_cause != ESP_RST_SW)) {
-
-        // Clear persistent variables.
-        desired_mode = RESET_MODE;
-        mode = NULL_MODE;
-        boot_num = 0;
-
-        time_shift_average = 0;
-        time_shift_samples = 0;
-        time_correction_step = 0;
-        time_deviation_average = 0;
-        time_deviation_samples = 0;
-        
-        /*
-            As there will be a resync after a hard reset, there is no need to
-            initialize the following variables:
-
-            strf_last_sync_hour_buf;
-            strf_last_sync_minute_buf;
-            last_sync_hour;
-            last_sync_minute;
-            strf_battery_value_buf;
-            battery_status;
-            wifi_strength;
-        */
-
+    // Validate the persistent state, and wipe it if it can not be trusted.
+    // After a wipe, we have to do a reset.
+    if (!rtcStateLoad((reset_cause == ESP_RST_DEEPSLEEP) || (reset_cause == ESP_RST_SW))) {
+        rtc_state.desired_mode = RESET_MODE;
     }
 
     // Rotate mode variable to last mode.
-    const uint8_t last_mode = mode;
+    uint8_t last_mode = rtc_state.mode;
+    uint16_t phases;
 
-    // Check if we have a valid desired mode.
-    if (desired_mode & (NORMAL_MODE + UPDATE_MODE + SECONDS_MODE + RESET_MODE)) {
-
-        // Set that as our current mode.
-        mode = desired_mode;
-
-    } else {
-
-        // If we do not have a valid desired mode, just clear the variable.
-        mode = NULL_MODE;
-
-    }
-
-    // Clear the desired mode
-    desired_mode = NULL_MODE;
-    
     // Next, we may need these inputs.
     pinMode(OTA_SW_PIN, INPUT_PULLUP);
     pinMode(BTN_TOP_PIN, INPUT_PULLUP);
+    pinMode(BTN_BOTTOM_PIN, INPUT_PULLUP);
+    pinMode(CHARGE_SENSE_PIN, INPUT_PULLUP);
 
-    // If we have woken up from deep sleep, investigate the cause.
-    if (reset_cause == ESP_RST_DEEPSLEEP && mode == NULL_MODE) {
+    // The mode is selected from the transition table, see `boot_mode.cpp`.
+    const bool charging = (digitalRead(CHARGE_SENSE_PIN) == LOW);
+    const BootModeInputs mode_inputs = getBootModeInputs(reset_cause, charging);
+    rtc_state.mode = bootModeSelect(mode_inputs);
 
-        // Get the wakeup cause.
-        const esp_sleep_wakeup_cause_t wakeup_cause = esp_sleep_get_wakeup_cause();
+    // A button waking us up was pressed right before the application timer started.
+    if (mode_inputs.wakes & WAKE_BUTTONS) profileModeSwitch(0);
 
-        // If the timer triggered the wakeup, we can be sure that we are either in normal mode.
-        if ( wakeup_cause == ESP_SLEEP_WAKEUP_TIMER ) { mode = NORMAL_MODE; }
-
-        // Here, we can check for a GPIO wakeup, if there is still no mode defined.
-        else if ( wakeup_cause == ESP_SLEEP_WAKEUP_GPIO ) {
-
-            // We can read the GPIO pins connected to the buttons.
-            // As the ESP reboots pretty fast, if the press is average length, it will still be pressed here.
-            // If the last mode was the same, do not enter update mode again, as this was a button press to exit.
-            // Update mode has a higher priority, we will check that first.
-
-            if      ( (digitalRead(OTA_SW_PIN) == LOW) && (last_mode != UPDATE_MODE) ) { mode = UPDATE_MODE;  }
-            else if ( digitalRead(BTN_TOP_PIN) == LOW )                                { mode = SECONDS_MODE; }
-
-        }
-
-    }
-
-    // If we are in normal mode, we may need to do a resync.
-    if ((mode == NORMAL_MODE) && (boot_num % RESYNC_EVERY == 0)) { mode = RESYNC_MODE; }
-
-    // If we are not in any mode yet, just say we were in a reset.
-    // This should not be strictly necessary, but it's a good catch all.
-    // (An error could occur if we soft reset without a valid desired mode.)
-    if (mode == NULL_MODE) { mode = RESET_MODE; }
+    // Clear the desired mode, and store the state of charging.
+    rtc_state.desired_mode = NULL_MODE;
+    rtc_state.charging = charging;
 
 
     // --- Powering Up, Initializing, Detecting Mode Modes ---
 
 
     // Adjust the time with the correction value.
-    adjustTime(time_correction_step);
+    adjustTime(rtc_state.time_correction_step);
 
     // Setting up the AUX pin for a possible use.
     pinMode(AUX_PWR_PIN, OUTPUT);
@@ -216,93 +229,35 @@ void setup() {
         digitalWrite(AUX_PWR_PIN, HIGH);
     #endif /* AUX_FOR_DISP */
 
-    // If we are not in update mode, we can attach the interrupt to the update button.
-    if (mode != UPDATE_MODE) {
-        attachInterrupt(digitalPinToInterrupt(OTA_SW_PIN), intUpdateMode, FALLING);
-    }
-
-    // If we are in normal mode, we can attach the interrupt to the top button.
-    if (mode == NORMAL_MODE) {
-        attachInterrupt(digitalPinToInterrupt(BTN_TOP_PIN), intSecondsMode, FALLING);
-    }
-
-    // Measure battery voltage if needed.
-    if (boot_num % BATT_SENSE_EVERY == 0) {
-
-        // Turn on the aux power if the voltage divider needs it.
-        #if defined(AUX_FOR_BATT_SENSE)
-            digitalWrite(AUX_PWR_PIN, HIGH);
-        #endif /* AUX_FOR_BATT_SENSE */
-
-        // Set the battery voltage pin to input.
-        pinMode(BATT_SENSE_PIN, INPUT);
-
-        // Get raw measurement with oversampling.
-        uint32_t battery_raw;
-        for (uint8_t i = 0; i < ADC_OVER_SAMPLE_COUNT; i++) {
-            battery_raw += analogRead(BATT_SENSE_PIN);
-        }
-        battery_raw = battery_raw / ADC_OVER_SAMPLE_COUNT;
-
-        // Calibrate the battery voltage reading.
-        esp_adc_cal_characteristics_t adc_chars;
-        esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &adc_chars);
-        uint32_t battery_voltage = esp_adc_cal_raw_to_voltage(battery_raw, &adc_chars) * ADC_FACTOR;
-
-        // Turn off the aux power if display does not need it.
-        #if !defined(AUX_FOR_DISP)
-            digitalWrite(AUX_PWR_PIN, LOW);
-        #endif /* !AUX_FOR_DISP */
-
-        // Detect critically low battery level, switch to critical mode.
-        if (battery_voltage <= CRITICAL_BATTERY_LEVEL) {
-            mode = CRITICAL_MODE;
-        }
-
-        // Calculate battery percent based on an approximation. 
-        uint8_t battery_percent;
-        if (battery_voltage >= (4200 - FULL_BATTERY_TOLERANCE)) {
-            battery_percent = 100;
-        } else if (battery_voltage >= 3870) {
-            battery_percent = round(120 * ((float)battery_voltage/1000) - 404);
-        } else if (battery_voltage > 3300) {
-            battery_percent = round(113 / (1 + exp(46.3 - 12 * ((float)battery_voltage/1000))));
-        } else {
-            battery_percent = 0;
-        }
-
-        // Round, and convert to a string.
-        sprintf(strf_battery_value_buf, "%d%%", battery_percent);
-
-        // Set battery status based on level.
-        if (battery_percent < 25) {
-            battery_status = 0;
-        } else if (battery_percent < 50) {
-            battery_status = 1;
-        } else if (battery_percent < 75) {
-            battery_status = 2;
-        } else {
-            battery_status = 3;
-        }
-
-    }
+    // Attach the interrupts that request other modes.
+    attachModeInterrupts();
 
-    // Configure the time zone, regardless of the mode. We have to do it either way.
-    configureTimeZone();
-
-    // The order of operations is intentional.
-    // This way the display can initialize while we read sensors.
+    /*
+        The work before the modes runs as a graph of boot steps, see
+        `boot_steps` and `task_graph.h`. The display initializes while
+        the battery is measured, and when syncing, WiFi connects while the
+        display is cleared. The order only matters where a step depends on
+        an other. The mode can change to CRITICAL in the measurement, the
+        steps depending on it check the mode again.
+    */
+    display_wipe = bootModePhases(rtc_state.mode) & PHASE_WIPE;
+    uint8_t steps = (1 << STEP_TIME_ZONE) | (1 << STEP_DISPLAY);
+    if ((rtc_state.boot_num % BATT_SENSE_EVERY == 0) || (bootModePhases(rtc_state.mode) & PHASE_MEASURE)) steps |= (1 << STEP_MEASURE);
+    if (bootModePhases(rtc_state.mode) & PHASE_SYNC) steps |= (1 << STEP_WIFI);
+    boot_steps_result = taskGraphRun(boot_steps, STEP_COUNT, steps, boot_step_records);
 
 
     // --- Blocking Modes ---
 
 
-    // Initialize the display.
-    // If we are in RESET mode, we have to wipe the screen.
-    displayInit(mode & (CRITICAL_MODE + RESET_MODE));
+    // Measure the render functions for development purposes.
+    #if defined(RENDER_BENCHMARK)
+        RenderBenchmarkResult bench_results[RENDER_BENCHMARK_CASES];
+        renderBenchmarkRun(bench_results);
+    #endif /* RENDER_BENCHMARK */
 
     // If we are in critical mode, we need to display a warning message, and shut down the processor.
-    if (mode == CRITICAL_MODE) {
+    if (bootModePhases(rtc_state.mode) & PHASE_CRITICAL) {
 
         // A full refresh may be needed.
         #if !defined(AUX_FOR_DISP) && defined(PREFER_FAST_REFRESH)
@@ -312,6 +267,7 @@ void setup() {
         #endif /* !AUX_FOR_DISP && PREFER_FAST_REFRESH */
 
         // Draw to display
+        clockForget();
         displayStartDraw(/*fast=*/ fast_refresh);
 
         displayRenderCriticalMessage();
@@ -322,18 +278,38 @@ void setup() {
         displayHibernate();
         digitalWrite(AUX_PWR_PIN, LOW);
 
-        // Disable wakeup sources
+        // Disable wakeup sources, except for the start of charging.
         esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+        esp_deep_sleep_enable_gpio_wakeup(1 << CHARGE_SENSE_PIN_NUM, ESP_GPIO_WAKEUP_GPIO_LOW);
+
+        // Save the persistent state.
+        rtcStateCommit();
 
-        // Go into INDEFINITE deep sleep. (Basically shut down.)
+        // Go into INDEFINITE deep sleep, until charging starts. (Basically shut down.)
         esp_deep_sleep_start();
 
         // Nothing is run after this.
         
     }
 
+    /*
+        Buttons pressed while we are awake do not restart the processor.
+        Their interrupts only request a mode, see `mode_switch.h`, and the
+        blocking and running modes return here as soon as they can.
+        The display is already initialized, so the next refresh is the
+        only delay the user sees, after the button is released. The release
+        is waited for, so the bounce of the contact is not an other request.
+    */
+runMode:
+
+    // Look up the work of the mode once, the phases below only check this.
+    phases = bootModePhases(rtc_state.mode);
+
+    // A button may have switched a fast boot to a mode that needs the Arduino runtime.
+    fastBootInitRuntime(phases);
+
     // If we are in update mode, we basically have to stall the processor.
-    if (mode == UPDATE_MODE) {
+    if (phases & PHASE_UPDATE) {
 
         // Turn on aux power for external led if needed.
         #if defined(AUX_FOR_EXT_LED)
@@ -345,7 +321,9 @@ void setup() {
         digitalWrite(EXT_LED_PIN, LOW);
 
         // Turn the update button into a button returning to normal mode.
-        attachInterrupt(digitalPinToInterrupt(OTA_SW_PIN), intNormalMode, FALLING);
+        // The press that selected this mode may still bounce, so it has to end first.
+        waitForButtonRelease();
+        attachButtonInterrupt(OTA_SW_PIN, intNormalMode);
 
         // A full refresh may be needed.
         #if !defined(AUX_FOR_DISP) && defined(PREFER_FAST_REFRESH)
@@ -355,20 +333,30 @@ void setup() {
         #endif /* !AUX_FOR_DISP && PREFER_FAST_REFRESH */
         
         // Draw to display
+        clockForget();
         displayStartDraw(/*fast=*/ fast_refresh);
         
         displayRenderUpdateMessage();
 
         displayEndDraw();
+        profileModeRefresh();
 
         // Turn off the display and auxiliary power. We do not need them any more.
         displayHibernate();
         digitalWrite(AUX_PWR_PIN, LOW);
 
-        // Block all other tasks.
-        for (;;) vTaskDelay(loop_tick_delay);
+        // Block all other tasks, until a button requests an other mode.
+        while (modeSwitchPending() == NULL_MODE) vTaskDelay(loop_tick_delay);
 
-        // Nothing is run after this.
+        // Turn off the led, and power the display back up if needed.
+        digitalWrite(EXT_LED_PIN, HIGH);
+        #if defined(AUX_FOR_DISP)
+            digitalWrite(AUX_PWR_PIN, HIGH);
+        #endif /* AUX_FOR_DISP */
+
+        // Run the requested mode.
+        last_mode = switchToPendingMode();
+        goto runMode;
 
     }
 
@@ -378,43 +366,23 @@ void setup() {
  
     // If we are in RESET mode, the clock may not be set yet. Instead of a time, 
     // we display a message, or just clear the display.
-    if (mode == RESET_MODE) {
+    if (phases & PHASE_CLEAR) {
         
+        clockForget();
         displayStartDraw(/*fast=*/ true);
         displayEndDraw();
 
     }
 
-    // In RESET and RESYNC mode, we need to connect to a wifi network, and sync with and SNTP server.
-    if (mode & (RESYNC_MODE + RESET_MODE)) {
+    // In RESET, RESYNC and CHARGING mode, we need to connect to a wifi network, and sync with and SNTP server.
+    if (phases & PHASE_SYNC) {
         
         // Skip the sync for development purposes.
         #if !defined(SKIP_SYNC)
 
-        // Get precise time.
-        gettimeofday(&tv_now, NULL);
-        int64_t time_before_ms = (int64_t)tv_now.tv_sec * (int64_t)1000 + ((int64_t)tv_now.tv_usec / (int64_t)1000);
-
+        // The WiFi was started by `stepWifi`, count the time since then.
         // Try to make and educated guess of the sync time.
-        int64_t time_waiting_ms = 0;
-
-        // Set up variable for potential interrupt.
-        loop_running = true;
-        
-        // Configure SNTP time sync.
-        sntp_setoperatingmode(SNTP_SYNC_MODE_IMMED);
-        sntp_setservername(1, SNTP_1);
-        sntp_setservername(2, SNTP_2);
-        sntp_set_time_sync_notification_cb(sntpSyncCallback);
-        sntp_init();
-        
-        // Set up WiFi
-        WiFi.persistent(false);
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(ssid, password);
-
-        // Configure the time zone again, as the settings get lost here.
-        configureTimeZone();
+        int64_t time_waiting_ms = millis() - wifi_start_time;
         
         // Wait for WiFi to connect, and time to sync.
         do {
@@ -433,22 +401,23 @@ void setup() {
         int64_t time_after_ms = (int64_t)tv_now.tv_sec * (int64_t)1000 + ((int64_t)tv_now.tv_usec / (int64_t)1000);
         
         // Calculate the resulting time difference from the sync.
-        int32_t time_deviation_ms = (int32_t)(time_after_ms - time_before_ms - time_waiting_ms);
-        int32_t time_shift_ms = time_deviation_ms + time_shift_average;
+        int32_t time_deviation_ms = (int32_t)(time_after_ms - sync_time_before_ms - time_waiting_ms);
+        int32_t time_shift_ms = time_deviation_ms + rtc_state.time_shift_average;
 
         // Skip average calculation after reset, as the shift here can be chaotic.
-        if (mode != RESET_MODE) {
+        // Also skip it for syncs out of the schedule, as the shift is only for RESYNC_EVERY boots.
+        if (phases & PHASE_SHIFT) {
 
             // Calculate new average time shift.
             int32_t time_shift_history_weight = 3; // Just an educated guess at this point!
-            time_shift_average = (time_shift_ms + (time_shift_average * time_shift_history_weight)) / (time_shift_history_weight + (int32_t)1);
-            time_shift_samples++;
+            rtc_state.time_shift_average = (time_shift_ms + (rtc_state.time_shift_average * time_shift_history_weight)) / (time_shift_history_weight + (int32_t)1);
+            rtc_state.time_shift_samples++;
 
             // Calculate the new time deviation.
-            if (time_shift_samples > 1) {
+            if (rtc_state.time_shift_samples > 1) {
 
-                time_deviation_average = (abs(time_deviation_ms) + (time_deviation_average * time_deviation_samples)) / (time_deviation_samples + (int32_t)1);
-                time_deviation_samples++;
+                rtc_state.time_deviation_average = (abs(time_deviation_ms) + (rtc_state.time_deviation_average * rtc_state.time_deviation_samples)) / (rtc_state.time_deviation_samples + (int32_t)1);
+                rtc_state.time_deviation_samples++;
 
             } else {
 
@@ -457,7 +426,7 @@ void setup() {
             }
 
             // Calculate the new time correction step size.
-            time_correction_step = time_shift_average / (int32_t)RESYNC_EVERY;
+            rtc_state.time_correction_step = rtc_state.time_shift_average / (int32_t)RESYNC_EVERY;
 
         } else {
 
@@ -467,84 +436,32 @@ void setup() {
 
         }
 
+        // After a sync out of the schedule, restart the schedule from here.
+        if (phases & PHASE_RESCHEDULE) {
+            rtc_state.boot_num -= rtc_state.boot_num % RESYNC_EVERY;
+        }
+
         // Get wifi network strength.
-        wifi_strength = WiFi.RSSI();
+        rtc_state.wifi_strength = wifiSyncStrength();
 
         // Make an HTTP POST request for data logging.
-        #if defined(REPORT_TELEMETRY)
-
-            /* 
-                The buffer neds to be big enough to fit all the data.
-                The size of the different data parts:
-                    - Outline:              250
-                    - UUID:                 36
-                    - BatteryLevel:         4
-                    - BootNum:              10
-                    - currentMode:          3
-                    - timeShift:            10
-                    - timeShiftAverage:     10
-                    - timeShiftSamples:     10
-                    - syncDuration:         10
-                    - wifiStrength:         4
-                    - timeDeviation:        10
-                    - timeDeviationAverage: 10
-                    - timeDeviationSamples: 10
-                Total:                      377
-            */
-            char strf_post_buf[380];
-
-            // Fill the buffer with the formatted string.
-            sprintf(strf_post_buf,
-                "{"
-                    "\"uuid\":\"%s\","
-                    "\"bootNum\":\"%d\","
-                    "\"currentMode\":\"%d\","
-                    "\"batteryLevel\":\"%s\","
-                    "\"wifiStrength\":\"%d\","
-                    "\"syncDuration\":\"%d\","
-                    "\"timeShift\":\"%d\","
-                    "\"timeShiftAverage\":\"%d\","
-                    "\"timeShiftSamples\":\"%d\","
-                    "\"timeDeviation\":\"%d\","
-                    "\"timeDeviationAverage\":\"%d\","
-                    "\"timeDeviationSamples\":\"%d\""
-                "}",
-                uuid, boot_num, mode, strf_battery_value_buf, wifi_strength,
-                (int32_t)time_waiting_ms,
-                time_shift_ms, time_shift_average, time_shift_samples,
-                time_deviation_ms, time_deviation_average, time_deviation_samples
-            );
-
-            // Create an http client.
-            HTTPClient http;
-
-            // Configure url and data to send.
-            http.begin(reportingUrl);
-            http.addHeader("Content-Type", "application/json");
-            int httpRes = http.POST(strf_post_buf);
-
-            // Close the connection.
-            http.end();
-
-        #endif
+        wifiSyncReport((int32_t)time_waiting_ms, time_shift_ms, time_deviation_ms);
         
         // Turn off the Wifi
-        WiFi.mode(WIFI_OFF);
+        wifiSyncStop();
+        wifi_on = false;
+        wifi_time = millis() - wifi_start_time;
         
         #endif /* !SKIP_SYNC */
 
         // Set the last sync times
-        last_sync_hour = timeinfo.tm_hour;
-        last_sync_minute = timeinfo.tm_min;
-
-        // Update the strings
-        sprintf(strf_last_sync_hour_buf, "%02d", last_sync_hour);
-        sprintf(strf_last_sync_minute_buf, "%02d", last_sync_minute);
+        rtc_state.last_sync_hour = timeinfo.tm_hour;
+        rtc_state.last_sync_minute = timeinfo.tm_min;
 
     }
 
     // Display seconds in the seconds mode.
-    if (mode == SECONDS_MODE) {
+    if (phases & PHASE_SECONDS) {
 
         // A full refresh may be required first.
         #if defined(AUX_FOR_DISP)
@@ -563,7 +480,7 @@ void setup() {
                 // Attach a loop stopping interrupt to the button.
                 // This is done here to mitigate the issue of the seconds mode instantly quitting
                 // when the button is pressed for a bit too long.
-                attachInterrupt(digitalPinToInterrupt(BTN_TOP_PIN), intLoopStop, FALLING);
+                attachButtonInterrupt(BTN_TOP_PIN, intLoopStop);
 
             }
             
@@ -571,55 +488,186 @@ void setup() {
             getTime();
             formatStrings();
             
-            // Print the time and seconds to the display
-            displayStartDraw(/*fast=*/ fast_refresh);
-            fast_refresh = true;
-            
-            displayRenderBorders();
-            displayRenderStatusBar(strf_battery_value_buf, strf_last_sync_hour_buf, strf_last_sync_minute_buf, battery_status);
-            displayRenderTime(strf_hour_buf, strf_minute_buf);
-            displayRenderDate(strf_date_buf);
-            displayRenderSecond(timeinfo.tm_sec);
-            
-            displayEndDraw();
+            // The whole frame is only drawn at the start, and when the minute changes.
+            // Otherwise only the small window of the seconds is refreshed.
+            if (i == 0 || timeinfo.tm_sec == 0) {
+
+                // Print the time and seconds to the display
+                // The seconds cover the colon, so this is not the plain clock face.
+                clockForget();
+                displayStartDraw(/*fast=*/ fast_refresh);
+                fast_refresh = true;
+                
+                renderClockFace(clock_strings, clock_values, CLOCK_FIELD_ALL);
+                displayRenderSecond(timeinfo.tm_sec);
+                
+                displayEndDraw();
+                profileModeRefresh();
+
+            } else {
+
+                // Print only the seconds to the display
+                displayStartDraw(/*fast=*/ true, /*full=*/ false);
+                displaySetSecondWindow();
 
-            do {
-                getTime();
-                vTaskDelay(loop_tick_delay);
-            } while (timeinfo.tm_sec == last_second);
+                displayRenderSecond(timeinfo.tm_sec);
+
+                displayEndDraw();
+
+            }
+
+            // Sleep until the next second, or until the loop is stopped.
+            uint32_t time_to_second = getTimePrecise();
+            while ((timeinfo.tm_sec == last_second) && loop_running && (modeSwitchPending() == NULL_MODE)) {
+                lightSleep(time_to_second, 0);
+                time_to_second = getTimePrecise();
+            }
             
             last_second = timeinfo.tm_sec;
 
-            if (!loop_running) break;
+            if (!loop_running || (modeSwitchPending() != NULL_MODE)) break;
 
         }
         
         // Detach the interrupt and attach the original one.
-        detachInterrupt(digitalPinToInterrupt(BTN_TOP_PIN));
+        // A stopping press may still bounce, it must not request a mode again.
+        detachButtonInterrupt(BTN_TOP_PIN);
+        if (!loop_running) waitForButtonRelease();
 
         // Reset the variable.
         loop_running = true;
 
-        // Clear the seconds with the final render
-        goto finalRender;
+    }
 
-    };
+    // Run a stopwatch in stopper mode.
+    if (phases & PHASE_STOPPER) {
 
-    // If we are really close to the minute, wait for it.
-    // In other cases, we will just wake up before it.
-    do {
+        // A full refresh may be required first.
+        #if defined(AUX_FOR_DISP)
+            fast_refresh = false;
+        #else
+            fast_refresh = true;
+        #endif /* AUX_FOR_DISP */
+
+        // Draw the stopper, with the last result at the bottom.
+        clockForget();
+        displayStartDraw(/*fast=*/ fast_refresh);
+
+        displayRenderFlag((char*)"STOPPER");
+        displayRenderStopper(0, /*precise=*/ true);
+        displayRenderStopperLast(rtc_state.stopper_elapsed);
+
+        displayEndDraw();
+        profileModeRefresh();
+
+        // The button that selected this mode may still be pressed.
+        waitForButtonRelease();
+
+        /*
+            Either button starts and stops the stopper.
+            The time is kept by the high resolution timer, that keeps counting
+            in light sleep. The buttons wake the processor up from light sleep
+            almost instantly, so the start and stop times are precise.
+        */
+
+        // Wait for the start, or give up after a while.
+        // The update button also wakes us up, but it requests an other mode instead.
+        if (lightSleep((uint64_t)STOPPER_IDLE_TIMEOUT * 1000000, button_wakeup_mask) && (modeSwitchPending() == NULL_MODE)) {
+
+            const int64_t start_us = esp_timer_get_time();
+            const int64_t update_us = (int64_t)STOPPER_UPDATE_EVERY * 1000000;
+            int64_t elapsed_us = 0;
+            bool stopped = false;
+
+            waitForButtonRelease();
+
+            /*
+                Sleep until the next update, or the stop.
+                The update button wakes us up too, as its interrupt is attached.
+                It ends the stopper like a stop press, the time until then is
+                kept as the result, and the update mode follows.
+                A press while the display refreshes is timestamped by
+                `displayBusySleep`, so it is not lost, and it stops the time
+                of the press, not the end of the refresh.
+            */
+            while (elapsed_us < (int64_t)STOPPER_MAX_MINUTES * 60000000) {
+
+                elapsed_us = esp_timer_get_time() - start_us;
+                stopped = lightSleep(update_us - (elapsed_us % update_us), button_wakeup_mask);
+                elapsed_us = esp_timer_get_time() - start_us;
+
+                if (stopped) break;
+
+                // Refresh only the elapsed time, without the hundredths.
+                displayStartDraw(/*fast=*/ true, /*full=*/ false);
+                displaySetStopperWindow();
+
+                displayRenderStopper(elapsed_us / 1000, /*precise=*/ false);
+
+                busy_press_us = 0;
+                busy_wakeup_mask = button_wakeup_mask;
+                displayEndDraw();
+                busy_wakeup_mask = 0;
+
+                if (busy_press_us != 0) {
+                    elapsed_us = busy_press_us - start_us;
+                    stopped = true;
+                    break;
+                }
+                if (modeSwitchPending() != NULL_MODE) break;
+
+            }
+
+            // Save the final result, so it survives deep sleep.
+            rtc_state.stopper_elapsed = elapsed_us / 1000;
+
+            // Show the precise final result.
+            displayStartDraw(/*fast=*/ true, /*full=*/ false);
+            displaySetStopperWindow();
+
+            displayRenderStopper(rtc_state.stopper_elapsed, /*precise=*/ true);
+
+            displayEndDraw();
+
+            waitForButtonRelease();
+
+            // Keep the result on the display until the minute, or until a button is pressed.
+            getTime();
+            if (modeSwitchPending() == NULL_MODE) lightSleep((uint64_t)(60 - timeinfo.tm_sec) * 1000000, button_wakeup_mask);
+            waitForButtonRelease();
+
+        }
+
+        // Return to the clock with the final render.
         getTime();
-        vTaskDelay(loop_tick_delay);
-    } while (timeinfo.tm_sec > (59 - OMIT_SLEEP));
+
+    }
+
+    // If we are really close to the minute, the clock face of that minute is rendered
+    // and loaded into the display now, and only the refresh waits for the minute.
+    // In other cases, we will just wake up before it.
+    // The seconds and stopper modes return to the clock right away.
+    if (phases & PHASE_WAIT_MINUTE) {
+        getTimePrecise();
+        if (timeinfo.tm_sec > (59 - OMIT_SLEEP)) {
+            now += 60 - timeinfo.tm_sec;
+            timeZoneLocal(now, &timeinfo);
+        }
+    }
+    refresh_minute = now - timeinfo.tm_sec;
 
     // Format time for display
     formatStrings();
 
-finalRender:
-
 
     // --- Normal Mode ---
 
+
+    // If a button requested an other mode, run that instead of the final render.
+    if (modeSwitchPending() != NULL_MODE) {
+        last_mode = switchToPendingMode();
+        goto runMode;
+    }
     
     // If the display was not powered off, we have the opportunity to do a partial.
     // But only if we are coming from normal or reset mode.
@@ -628,7 +676,7 @@ finalRender:
         #if defined(PREFER_FAST_REFRESH)
             fast_refresh = true;
         #else
-            fast_refresh = (mode & (NORMAL_MODE + RESYNC_MODE)) &&
+            fast_refresh = (rtc_state.mode & (NORMAL_MODE + RESYNC_MODE)) &&
                 (last_mode & (RESET_MODE + NORMAL_MODE + RESYNC_MODE));
         #endif /* PREFER_FAST_REFRESH */
     #else
@@ -636,16 +684,52 @@ finalRender:
     #endif /* !AUX_FOR_DISP */
 
     // Depending on the settings, we have to do a full refresh every so often.
-    if (boot_num % FULL_REFRESH_EVERY == 0) fast_refresh = false;
+    if (rtc_state.boot_num % FULL_REFRESH_EVERY == 0) fast_refresh = false;
 
-    displayStartDraw(fast_refresh);
+    // A partial refresh only has to cover the changed fields, the rest is already on the display.
+    // If nothing changed, the refresh is skipped.
+    uint8_t clock_fields = fast_refresh ? clock_changed : CLOCK_FIELD_ALL;
+    if (clock_fields != 0) {
 
-    displayRenderBorders();
-    displayRenderStatusBar(strf_battery_value_buf, strf_last_sync_hour_buf, strf_last_sync_minute_buf, battery_status);
-    displayRenderTime(strf_hour_buf, strf_minute_buf);
-    displayRenderDate(strf_date_buf);
+        // The last boot may have rendered this frame already, while its refresh was running.
+        const uint8_t ahead_fields = displayAheadFields(clock_values);
+        if (((ahead_fields & clock_fields) == clock_fields) && (fast_refresh || (ahead_fields == CLOCK_FIELD_ALL))) {
+
+            clock_fields = displayUseAhead(fast_refresh);
+
+        } else {
+
+            const int64_t render_start = esp_timer_get_time();
+
+            displayStartDraw(fast_refresh, /*full=*/ clock_fields == CLOCK_FIELD_ALL);
+            if (clock_fields != CLOCK_FIELD_ALL) clock_fields = displaySetClockWindow(clock_fields);
+            renderClockFace(clock_strings, clock_values, clock_fields);
+
+            render_time = esp_timer_get_time() - render_start;
+
+        }
+
+        // The frame of the next minute is rendered while the display is busy, see `displayBusySleep`.
+        #if defined(RENDER_AHEAD)
+            render_ahead_fields = clock_fields;
+        #endif /* RENDER_AHEAD */
+
+        // The frame is loaded into the display, then the refresh waits for its minute.
+        displayHoldRefresh(waitForRefreshMinute);
+
+        displayEndDraw();
+        render_ahead_fields = 0;
+        clockShown(clock_values);
+        profileModeRefresh();
+
+    }
 
-    displayEndDraw();
+    // A button may have been pressed during the refresh.
+    // Then the requested mode is run, the clock is already on the display.
+    if (modeSwitchPending() != NULL_MODE) {
+        last_mode = switchToPendingMode();
+        goto runMode;
+    }
 
     // Make the display go into deep sleep.
     displayHibernate();
@@ -654,7 +738,7 @@ finalRender:
     digitalWrite(AUX_PWR_PIN, LOW);
 
     // Increment boot counter
-    boot_num++;
+    rtc_state.boot_num++;
         
     // As the display refresh takes time, we have to get the time again.
     getTime();
@@ -663,9 +747,35 @@ finalRender:
     const uint64_t time_to_sleep = (60 - timeinfo.tm_sec) * 1000000 - (SLEEP_MARGIN * 1000);
     esp_sleep_enable_timer_wakeup(time_to_sleep);
 
+    // Print the profile of the boot for development purposes.
+    #if defined(BOOT_PROFILE)
+        bool display_warm;
+        const uint32_t display_init = displayInitTime(display_warm);
+        Serial.printf("Boot profile: mode=%u fast=%u to_setup=%u us awake=%u ms wifi=%u ms display_init=%u us warm=%u display_write=%u us render=%u us render_ahead=%u us refresh_lag=%u us heap_at_setup=%u heap_free=%u heap_min=%u stack_min_free=%u\n",
+            rtc_state.mode, fast_boot, (uint32_t)setup_start_us, millis(), wifi_time, display_init, display_warm, displayWriteTime(), render_time, render_ahead_time, refresh_lag,
+            setup_start_heap, esp_get_free_heap_size(), esp_get_minimum_free_heap_size(), uxTaskGetStackHighWaterMark(NULL));
+        for (uint8_t i = 0; i < STEP_COUNT; i++) {
+            if (!(steps & (1 << i))) continue;
+            Serial.printf("Boot step: %-9s start=%u us end=%u us%s\n", boot_steps[i].name,
+                boot_step_records[i].start_us, boot_step_records[i].end_us,
+                (boot_steps_result.critical_path & (1 << i)) ? " critical" : "");
+        }
+        Serial.printf("Boot steps: wall=%u us chain=%u us\n", boot_steps_result.wall_us, boot_steps_result.chain_us);
+        Serial.flush();
+    #endif /* BOOT_PROFILE */
+
+    // Charge the energy ledger with the cost of this boot, and the sleep.
+    ledgerChargeBoot(millis(), wifi_time, battery_voltage != 0,
+        display_full_refresh_time, display_partial_refresh_time, time_to_sleep);
+
     // Set the pins that will wake up from deep sleep.
     // We check witch one caused the wakeup at the start.
-    esp_deep_sleep_enable_gpio_wakeup((1 << OTA_SW_PIN_NUM) + (1 << BTN_TOP_PIN_NUM), ESP_GPIO_WAKEUP_GPIO_LOW);
+    // The start of charging can only wake us up, if we are not charging already.
+    esp_deep_sleep_enable_gpio_wakeup((1 << OTA_SW_PIN_NUM) + (1 << BTN_TOP_PIN_NUM) + (1 << BTN_BOTTOM_PIN_NUM), ESP_GPIO_WAKEUP_GPIO_LOW);
+    if (!charging) esp_deep_sleep_enable_gpio_wakeup(1 << CHARGE_SENSE_PIN_NUM, ESP_GPIO_WAKEUP_GPIO_LOW);
+
+    // Save the persistent state.
+    rtcStateCommit();
 
     // Go into deep sleep.
     // Nothing is run after this.
@@ -676,6 +786,62 @@ finalRender:
 void loop() {};
 
 
+// --- Fast Boot ---
+
+/*
+    Before `setup()`, the Arduino core runs `initArduino()`, that mounts
+    the NVS partition, sets the clock, and releases the Bluetooth memory.
+    None of these are needed to draw the time, only the radio uses NVS.
+
+    The call is wrapped with the `--wrap=initArduino` linker flag in
+    `platformio.ini`. On timer wakeups that select NORMAL mode, `setup()`
+    is started right away, in a task with the stack size of the loop task,
+    as the main task has a smaller stack. Every path of `setup()` ends in
+    deep sleep, so the main task waits forever, and the Arduino
+    initialization and the loop task are never reached.
+    A button pressed during the boot can request update mode, that needs
+    the runtime. Before the phases in `PHASES_NEED_RUNTIME`, the skipped
+    initialization is run by `fastBootInitRuntime`.
+    All other boots, and a failed task creation, continue with the
+    Arduino initialization.
+
+    The CPU clock is not set here, the board runs at the default 160MHz.
+    The time saved has not been measured on the hardware. With BOOT_PROFILE,
+    compare `to_setup` of boots with `fast=1` and `fast=0`.
+*/
+extern "C" void __wrap_initArduino() {
+
+    #if defined(FAST_BOOT)
+        fast_boot = fastBootPossible();
+        if (fast_boot && (xTaskCreate(fastBootTask, "loopTask", getArduinoLoopTaskStackSize(), NULL, 1, NULL) == pdPASS)) {
+            vTaskSuspend(NULL);
+        }
+        fast_boot = false;
+    #endif /* FAST_BOOT */
+
+    __real_initArduino();
+
+}
+
+/// @brief Runs `setup()` on a fast boot. It never returns, as every path ends in deep sleep.
+/// @param parameter Not used.
+void fastBootTask(void* parameter) {
+
+    setup();
+
+}
+
+/// @brief Runs the Arduino initialization skipped by a fast boot, before the first phase that needs it.
+/// @param phases The phases of the mode about to run.
+void fastBootInitRuntime(uint16_t phases) {
+
+    if (!fast_boot || runtime_initialized || !(phases & PHASES_NEED_RUNTIME)) return;
+    __real_initArduino();
+    runtime_initialized = true;
+
+}
+
+
 // --- Function Definitions ---
 
 
@@ -683,31 +849,29 @@ void loop() {};
 
 void IRAM_ATTR intUpdateMode() {
 
-    // Set desired mode to update mode.
-    desired_mode = UPDATE_MODE;
-
-    // Restart.
-    esp_restart();
+    // Request update mode, the running boot switches to it.
+    modeSwitchRequest(UPDATE_MODE);
 
 }
 
 void IRAM_ATTR intSecondsMode() {
 
-    // Set desired mode to seconds mode.
-    desired_mode = SECONDS_MODE;
+    // Request seconds mode, the running boot switches to it.
+    modeSwitchRequest(SECONDS_MODE);
 
-    // Restart.
-    esp_restart();
+}
+
+void IRAM_ATTR intStopperMode() {
+
+    // Request stopper mode, the running boot switches to it.
+    modeSwitchRequest(STOPPER_MODE);
 
 }
 
 void IRAM_ATTR intNormalMode() {
 
-    // Set desired mode to normal mode.
-    desired_mode = NORMAL_MODE;
-
-    // Restart.
-    esp_restart();
+    // Request normal mode, the running boot switches to it.
+    modeSwitchRequest(NORMAL_MODE);
 
 }
 
@@ -725,23 +889,111 @@ void IRAM_ATTR sntpSyncCallback(timeval *tv) {
 }
 
 
+// --- Boot Steps ---
+
+/// @brief Measures the battery voltage, and updates the battery status.
+/// If the measurement fails, the last values are kept.
+/// Switches to critical mode if the battery is critically low.
+void stepMeasure() {
+
+    battery_voltage = batteryMeasure();
+    if (battery_voltage != 0) {
+
+        // Detect critically low battery level, switch to critical mode.
+        // While charging, the battery is recovering, so this is skipped.
+        if ((battery_voltage <= CRITICAL_BATTERY_LEVEL) && !rtc_state.charging) {
+            rtc_state.mode = CRITICAL_MODE;
+        }
+
+        // Calculate battery percent based on the discharge curve,
+        // and reconcile it with the energy ledger.
+        const uint8_t battery_percent = ledgerReconcile(batteryPercent(battery_voltage));
+
+        // Store the percent, it is converted to a string when displayed.
+        rtc_state.battery_percent = battery_percent;
+
+        // Set battery status based on level.
+        if (battery_percent < 25) {
+            rtc_state.battery_status = 0;
+        } else if (battery_percent < 50) {
+            rtc_state.battery_status = 1;
+        } else if (battery_percent < 75) {
+            rtc_state.battery_status = 2;
+        } else {
+            rtc_state.battery_status = 3;
+        }
+
+    }
+
+}
+
+/// @brief Starts connecting to WiFi, and syncing the time, if the mode needs it.
+void stepWifi() {
+
+    // Skip the sync for development purposes.
+    #if !defined(SKIP_SYNC)
+
+    // The battery may be critically low.
+    if (!(bootModePhases(rtc_state.mode) & PHASE_SYNC)) return;
+
+    // Get precise time.
+    struct timeval tv_before;
+    gettimeofday(&tv_before, NULL);
+    sync_time_before_ms = (int64_t)tv_before.tv_sec * (int64_t)1000 + ((int64_t)tv_before.tv_usec / (int64_t)1000);
+
+    // Set up variable for potential interrupt.
+    loop_running = true;
+
+    // Configure SNTP time sync, and set up WiFi.
+    // This is the only place the networking stacks are started, see `wifi_sync.cpp`.
+    wifi_start_time = millis();
+    wifi_on = true;
+    wifiSyncStart(sntpSyncCallback);
+
+    #endif /* !SKIP_SYNC */
+
+}
+
+/// @brief Gets the local time. The time zone transitions are calculated here if needed.
+void stepTimeZone() {
+
+    getTime();
+
+}
+
+/// @brief Initializes the display.
+/// If we are in RESET mode, we have to wipe the screen.
+/// When charging starts, we have the power for a clean wipe.
+void stepDisplay() {
+
+    if (display_wipe) clockForget();
+    displayInit(display_wipe);
+
+    // Sleep while the display is refreshing, instead of polling the BUSY pin.
+    displaySetBusyCallback(displayBusySleep);
+
+}
+
+
 // --- Time related functions ---
 
 /// @brief Get the time and local time, and save them to the global variables.
 void getTime() {
 
     time(&now);
-    localtime_r(&now, &timeinfo);
+    timeZoneLocal(now, &timeinfo);
 
 }
 
-/// @brief Get the time, and set the timezone.
-void configureTimeZone() {
+/// @brief Get the time and local time from a single precise sample, and save them to the global variables.
+/// @return The microseconds remaining until the next full second.
+uint32_t getTimePrecise() {
 
-    time(&now);
-    setenv("TZ", TIMEZONE, 1);
-    tzset();
-    localtime_r(&now, &timeinfo);
+    gettimeofday(&tv_now, NULL);
+    now = tv_now.tv_sec;
+    timeZoneLocal(now, &timeinfo);
+
+    return 1000000 - tv_now.tv_usec;
 
 }
 
@@ -764,11 +1016,316 @@ void adjustTime(int32_t offset) {
 
 }
 
-/// @brief Update the global time string buffers with the corresponding values.
+/// @brief Update the clock face values and texts, and find the fields that differ from the display.
 void formatStrings() {
 
-    strftime(strf_hour_buf, sizeof(strf_hour_buf), "%H", &timeinfo);
-    strftime(strf_minute_buf, sizeof(strf_minute_buf), "%M", &timeinfo);
-    strftime(strf_date_buf, sizeof(strf_date_buf), "%F", &timeinfo);
+    clock_values.year = timeinfo.tm_year + 1900;
+    clock_values.month = timeinfo.tm_mon + 1;
+    clock_values.day = timeinfo.tm_mday;
+    clock_values.hour = timeinfo.tm_hour;
+    clock_values.minute = timeinfo.tm_min;
+
+    clock_values.battery_percent = rtc_state.battery_percent;
+    clock_values.battery_icon = rtc_state.charging ? BATTERY_STATUS_CHARGING : rtc_state.battery_status;
+    clock_values.days_remaining = rtc_state.ledger_days_remaining;
+    clock_values.last_sync_hour = rtc_state.last_sync_hour;
+    clock_values.last_sync_minute = rtc_state.last_sync_minute;
+
+    clock_changed = clockFormat(clock_values, clock_strings);
+
+}
+
+/// @brief Renders the fields of the clock face.
+/// @param strings The texts of the clock face.
+/// @param values The values of the clock face, for the icons.
+/// @param fields Mask of the `CLOCK_FIELD_` bits to render.
+void renderClockFace(ClockStrings& strings, const ClockValues& values, uint8_t fields) {
+
+    displayRenderBorders();
+    displayRenderStatusBar(strings.battery_value, strings.days_remaining, strings.last_sync_hour, strings.last_sync_minute, values.battery_icon, fields);
+    displayRenderTime(strings.hour, strings.minute, fields);
+    if (fields & CLOCK_FIELD_DATE) displayRenderDate(strings.date);
+
+}
+
+/*
+    While the display refreshes the clock face, the frame of the next minute
+    is rendered into the buffer, in the same window. The buffer is kept in
+    deep sleep, so if the values are still the same on the next boot, it
+    only has to be sent. The status bar is expected not to change.
+*/
+
+/// @brief Renders the clock face of the next minute into the buffer. Called while the display is busy.
+void renderAhead() {
+
+    ClockValues next_values = clock_values;
+    struct tm next_timeinfo;
+    timeZoneLocal(now - timeinfo.tm_sec + 60, &next_timeinfo);
+    next_values.year = next_timeinfo.tm_year + 1900;
+    next_values.month = next_timeinfo.tm_mon + 1;
+    next_values.day = next_timeinfo.tm_mday;
+    next_values.hour = next_timeinfo.tm_hour;
+    next_values.minute = next_timeinfo.tm_min;
+
+    // Fields changing outside the window, like the hour, are left to the next boot.
+    if (clockChangedFields(clock_values, next_values) & ~render_ahead_fields) return;
+    if (!displayStartAhead()) return;
+
+    ClockStrings next_strings;
+    clockFormat(next_values, next_strings);
+    renderClockFace(next_strings, next_values, render_ahead_fields);
+
+    displayEndAhead(next_values, render_ahead_fields);
+
+}
 
-}
\ No newline at end of file
+
+// --- Sleep and button related functions ---
+
+/*
+    In light sleep, the GPIO interrupts do not fire, and the pins used for the
+    wakeup have their interrupt type changed. To not miss any button presses,
+    every button with an attached interrupt is also a wakeup source, and its
+    interrupt is called manually after the wakeup.
+*/
+
+/// @brief Enters light sleep until the timer expires, or one of the pins is pulled low.
+/// @param time_us The maximum time to sleep for in microseconds.
+/// @param pin_mask Bit mask of the active low pins that can wake the processor up.
+/// Buttons with interrupts attached are always added.
+/// @return True if one of the pins caused the wakeup.
+bool lightSleep(uint64_t time_us, uint64_t pin_mask) {
+
+    // The display must not be left in the middle of a refresh, unless the end of the refresh wakes us up.
+    if (!(pin_mask & (1ULL << DISPLAY_BUSY_PIN))) {
+        while (digitalRead(DISPLAY_BUSY_PIN) == HIGH) vTaskDelay(loop_tick_delay);
+    }
+
+    // Buttons with interrupts have to wake us up too.
+    for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++) {
+        if (button_interrupts[pin] != NULL) pin_mask |= (1ULL << pin);
+    }
+
+    // Enable the wakeup sources.
+    // The interrupts are disabled first, as a low level interrupt would fire continuously while a button is held.
+    esp_sleep_enable_timer_wakeup(time_us);
+    for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++) {
+        if (!(pin_mask & (1ULL << pin))) continue;
+        gpio_intr_disable((gpio_num_t)pin);
+        gpio_wakeup_enable((gpio_num_t)pin, GPIO_INTR_LOW_LEVEL);
+    }
+    esp_sleep_enable_gpio_wakeup();
+
+    // Sleep. The processor continues here after the wakeup.
+    esp_light_sleep_start();
+    const bool pin_wakeup = (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO);
+
+    // Disable the wakeup sources, so they do not interfere with deep sleep.
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+
+    // Restore the interrupts, and call the ones whose button was pressed in light sleep.
+    for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++) {
+        if (!(pin_mask & (1ULL << pin))) continue;
+        gpio_wakeup_disable((gpio_num_t)pin);
+        if (button_interrupts[pin] == NULL) continue;
+        gpio_set_intr_type((gpio_num_t)pin, GPIO_INTR_NEGEDGE);
+        gpio_intr_enable((gpio_num_t)pin);
+        if (pin_wakeup && (digitalRead(pin) == LOW)) button_interrupts[pin]();
+    }
+
+    return pin_wakeup;
+
+}
+
+/// @brief Light sleeps until the display releases the BUSY pin. Called by GxEPD2 while it waits for a refresh.
+/// Buttons still request modes, and the wait is cut short after `DISPLAY_BUSY_SLEEP` for GxEPD2 to check its timeout.
+/// The first press of a button in `busy_wakeup_mask` is timestamped in `busy_press_us`.
+/// @param parameter Not used.
+void displayBusySleep(const void* parameter) {
+
+    // Render the next frame first, the CPU is idle anyway.
+    if (render_ahead_fields != 0) {
+        const int64_t render_start = esp_timer_get_time();
+        renderAhead();
+        render_ahead_fields = 0;
+        render_ahead_time = esp_timer_get_time() - render_start;
+        return;
+    }
+
+    // Light sleep would drop the WiFi connection.
+    if (wifi_on) {
+        vTaskDelay(loop_tick_delay);
+        return;
+    }
+
+    if (!lightSleep((uint64_t)DISPLAY_BUSY_SLEEP * 1000, (1ULL << DISPLAY_BUSY_PIN) | busy_wakeup_mask)) return;
+
+    // Only the first press is recorded, a held button would wake us up continuously.
+    for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++) {
+        if ((busy_wakeup_mask & (1ULL << pin)) && (digitalRead(pin) == LOW)) {
+            busy_press_us = esp_timer_get_time();
+            busy_wakeup_mask = 0;
+            return;
+        }
+    }
+
+}
+
+/// @brief Light sleeps until the minute on the clock face starts. Called by the display between loading the frame and the refresh.
+/// A button requesting an other mode cuts the wait short.
+void waitForRefreshMinute() {
+
+    while (true) {
+        gettimeofday(&tv_now, NULL);
+        const int64_t time_to_minute = (int64_t)(refresh_minute - tv_now.tv_sec) * 1000000 - tv_now.tv_usec;
+        if ((time_to_minute <= 0) || (modeSwitchPending() != NULL_MODE)) {
+            refresh_lag = (time_to_minute < 0) ? -time_to_minute : 0;
+            return;
+        }
+        lightSleep(time_to_minute, 0);
+    }
+
+}
+
+/// @brief Attaches an interrupt to the falling edge of a button, and remembers it for light sleep.
+/// @param pin The pin of the button.
+/// @param isr The interrupt function.
+void attachButtonInterrupt(uint8_t pin, void (*isr)()) {
+
+    button_interrupts[pin] = isr;
+    attachInterrupt(digitalPinToInterrupt(pin), isr, FALLING);
+
+}
+
+/// @brief Detaches the interrupt from a button.
+/// @param pin The pin of the button.
+void detachButtonInterrupt(uint8_t pin) {
+
+    button_interrupts[pin] = NULL;
+    detachInterrupt(digitalPinToInterrupt(pin));
+
+}
+
+/// @brief Attaches the interrupts requesting other modes, based on the current mode.
+void attachModeInterrupts() {
+
+    // If we are not in update mode, we can attach the interrupt to the update button.
+    if (rtc_state.mode != UPDATE_MODE) {
+        attachButtonInterrupt(OTA_SW_PIN, intUpdateMode);
+    }
+
+    // If we are in normal mode, we can attach the interrupts to the top and bottom buttons.
+    // In other modes, these buttons are used by the mode itself.
+    if (rtc_state.mode == NORMAL_MODE) {
+        attachButtonInterrupt(BTN_TOP_PIN, intSecondsMode);
+        attachButtonInterrupt(BTN_BOTTOM_PIN, intStopperMode);
+    } else {
+        detachButtonInterrupt(BTN_TOP_PIN);
+        detachButtonInterrupt(BTN_BOTTOM_PIN);
+    }
+
+}
+
+/// @brief Switches to the mode requested by a button, the caller runs it from `runMode`.
+/// The interrupts are only attached again once the button is released, so its bounce is not an other request.
+/// @return The mode switched from.
+uint8_t switchToPendingMode() {
+
+    const uint8_t last_mode = modeSwitchTake();
+    profileModeSwitch(modeSwitchRequestTime());
+    waitForButtonRelease();
+    attachModeInterrupts();
+    return last_mode;
+
+}
+
+/// @brief Reduces the reset and wakeup causes to the wake sources of the boot.
+/// @param reset_cause The reason of the reset.
+/// @return Mask of the wake sources, see `BootWake`.
+uint8_t getBootWakes(esp_reset_reason_t reset_cause) {
+
+    if (reset_cause == ESP_RST_SW) return 1 << WAKE_SOFT_RESET;
+    if (reset_cause != ESP_RST_DEEPSLEEP) return 1 << WAKE_POWER_ON;
+
+    // Get the wakeup cause.
+    const esp_sleep_wakeup_cause_t wakeup_cause = esp_sleep_get_wakeup_cause();
+    if (wakeup_cause == ESP_SLEEP_WAKEUP_TIMER) return 1 << WAKE_TIMER;
+    if (wakeup_cause != ESP_SLEEP_WAKEUP_GPIO) return 1 << WAKE_UNKNOWN;
+
+    // We can read the GPIO pins connected to the buttons.
+    // As the ESP reboots pretty fast, if the press is average length, it will still be pressed here.
+    // Every pressed button is reported, the priority is decided by `bootModeSelect`.
+    uint8_t wakes = 0;
+    if (digitalRead(OTA_SW_PIN) == LOW)     wakes |= 1 << WAKE_OTA_BUTTON;
+    if (digitalRead(BTN_TOP_PIN) == LOW)    wakes |= 1 << WAKE_TOP_BUTTON;
+    if (digitalRead(BTN_BOTTOM_PIN) == LOW) wakes |= 1 << WAKE_BOTTOM_BUTTON;
+    return (wakes != 0) ? wakes : (1 << WAKE_UNKNOWN);
+
+}
+
+/// @brief Collects the inputs of the mode selection. The persistent state has to be loaded first.
+/// @param reset_cause The reason of the reset.
+/// @param charging True if the battery is charging.
+/// @return The inputs for `bootModeSelect`.
+BootModeInputs getBootModeInputs(esp_reset_reason_t reset_cause, bool charging) {
+
+    BootModeInputs mode_inputs;
+    mode_inputs.wakes = getBootWakes(reset_cause);
+    mode_inputs.desired_mode = rtc_state.desired_mode;
+    mode_inputs.last_mode = rtc_state.mode;
+    mode_inputs.charging_started = charging && !rtc_state.charging;
+    mode_inputs.resync_due = (rtc_state.boot_num % RESYNC_EVERY == 0);
+    return mode_inputs;
+
+}
+
+/// @brief Checks if the boot can skip the Arduino initialization, see `__wrap_initArduino`.
+/// @return True on timer wakeups with a valid persistent state, that select NORMAL mode.
+bool fastBootPossible() {
+
+    const esp_reset_reason_t reset_cause = esp_reset_reason();
+    if (getBootWakes(reset_cause) != (1 << WAKE_TIMER) || !rtcStateValid()) return false;
+
+    pinMode(CHARGE_SENSE_PIN, INPUT_PULLUP);
+    const bool charging = (digitalRead(CHARGE_SENSE_PIN) == LOW);
+    return bootModeSelect(getBootModeInputs(reset_cause, charging)) == NORMAL_MODE;
+
+}
+
+/// @brief Waits until every button is released, and stays released for `BUTTON_DEBOUNCE_TIME`.
+/// A bouncing contact reads as an other press, so no interrupt may be attached to a button before this.
+void waitForButtonRelease() {
+
+    uint32_t released_time = millis();
+    while (millis() - released_time < BUTTON_DEBOUNCE_TIME) {
+        if ((digitalRead(OTA_SW_PIN) == LOW) || (digitalRead(BTN_TOP_PIN) == LOW) || (digitalRead(BTN_BOTTOM_PIN) == LOW)) {
+            released_time = millis();
+        }
+        vTaskDelay(loop_tick_delay);
+    }
+
+}
+
+/// @brief Records the start of a mode requested by a button, for the boot profile.
+/// @param request_us Time of the button press in microseconds.
+void profileModeSwitch(int64_t request_us) {
+
+    mode_request_us = request_us;
+    mode_switch_us = esp_timer_get_time();
+    mode_requested = true;
+
+}
+
+/// @brief Prints the latency of a mode requested by a button, after its first refresh.
+/// Only prints with the `BOOT_PROFILE` option, and only once for each request.
+void profileModeRefresh() {
+
+    #if defined(BOOT_PROFILE)
+        if (!mode_requested) return;
+        mode_requested = false;
+        Serial.printf("Mode latency: mode=%u to_switch=%u us to_refresh=%u us\n", rtc_state.mode,
+            (uint32_t)(mode_switch_us - mode_request_us), (uint32_t)(esp_timer_get_time() - mode_request_us));
+    #endif /* BOOT_PROFILE */
+
+}
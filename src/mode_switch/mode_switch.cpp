@@ -0,0 +1,55 @@
+#include "mode_switch.h"
+
+#include <esp_timer.h>
+
+#include "rtc_state/rtc_state.h"
+
+
+// --- Globals ---
+
+// Mode requested by a button, and the time of the press in microseconds.
+static volatile uint8_t pending_mode = NULL_MODE;
+static volatile int64_t pending_mode_us = 0;
+
+// Time of the press of the last request taken.
+static int64_t taken_mode_us = 0;
+
+
+// --- Mode Functions ---
+
+/// @brief Requests a mode, a later request replaces an earlier one. Safe to call from interrupts.
+/// @param mode A single mode bit.
+void IRAM_ATTR modeSwitchRequest(uint8_t mode) {
+
+    pending_mode_us = esp_timer_get_time();
+    pending_mode = mode;
+
+}
+
+/// @brief Checks for a request, without taking it.
+/// @return The requested mode, or the null mode.
+uint8_t modeSwitchPending() {
+
+    return pending_mode;
+
+}
+
+/// @brief Switches the persistent state to the requested mode, and clears the request.
+/// @return The mode switched from.
+uint8_t modeSwitchTake() {
+
+    const uint8_t last_mode = rtc_state.mode;
+    taken_mode_us = pending_mode_us;
+    rtc_state.mode = pending_mode;
+    pending_mode = NULL_MODE;
+    return last_mode;
+
+}
+
+/// @brief Gets the time of the press of the last request taken.
+/// @return Time from `esp_timer_get_time` in microseconds.
+int64_t modeSwitchRequestTime() {
+
+    return taken_mode_us;
+
+}
@@ -0,0 +1,27 @@
+#ifndef MODE_SWITCH_H
+#define MODE_SWITCH_H
+
+// --- Libraries ---
+#include <Arduino.h>
+
+// --- Components ---
+#include "boot_mode/boot_mode.h"
+
+
+// --- Mode Requests ---
+
+/*
+    Buttons pressed while we are awake do not restart the processor.
+    Their interrupts only request a mode here, the running mode checks
+    `modeSwitchPending` whenever it can stop, and returns to `runMode` in
+    `setup`, which takes the request with `modeSwitchTake`. The time of
+    the press is kept, so the latency of the switch can be measured.
+*/
+
+// --- Functions ---
+void IRAM_ATTR modeSwitchRequest(uint8_t mode);
+uint8_t modeSwitchPending();
+uint8_t modeSwitchTake();
+int64_t modeSwitchRequestTime();
+
+#endif /* MODE_SWITCH_H */
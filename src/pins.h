@@ -5,6 +5,7 @@
 
 #define BATT_SENSE_PIN       0             // May need aux power
 #define BATT_SENSE_PIN_NUM   GPIO_NUM_0
+#define BATT_SENSE_ADC_CH    0             // ADC1 channel of the pin
 
 #define OTA_SW_PIN           1             // Active low
 #define OTA_SW_PIN_NUM       GPIO_NUM_1
@@ -0,0 +1,157 @@
+#include "render_benchmark.h"
+
+#if defined(RENDER_BENCHMARK)
+
+#if !defined(VIRTUAL_DISPLAY)
+    #error "The render benchmark needs the virtual display, enable VIRTUAL_DISPLAY!"
+#endif /* !VIRTUAL_DISPLAY */
+
+#include <esp_timer.h>
+
+#include "display_helper/display_helper.h"
+
+
+/*
+    Times the render functions of `display_helper` over every value they
+    can be called with, and counts the pixels they write. Only the drawing
+    into the frame buffer is measured, the frames are never refreshed.
+
+    The results are printed to the serial port. The pixels per frame do
+    not depend on the speed of the processor, so they are checked on the
+    host, against the counts of an earlier run, see `test/test_render_benchmark`.
+    The time per frame does, so the first case is a reference, a fixed
+    square drawn by the primitives of Adafruit GFX only. The time of the
+    other cases relative to it changes little between computers, and is
+    checked there too. A font or layout change that makes rendering much
+    slower is noticed this way.
+*/
+
+
+// --- Globals ---
+extern VirtualDisplay display;
+
+
+// --- Helper Functions ---
+
+/// @brief Starts timing a case.
+static void benchmarkStart(RenderBenchmarkResult& result, const char* name, int64_t& start_us, uint32_t& start_pixels) {
+
+    result.name = name;
+    result.frames = 0;
+    start_pixels = display.pixels_written;
+    start_us = esp_timer_get_time();
+
+}
+
+/// @brief Stops timing a case, and prints the result.
+static void benchmarkEnd(RenderBenchmarkResult& result, int64_t start_us, uint32_t start_pixels) {
+
+    const int64_t elapsed_us = esp_timer_get_time() - start_us;
+    result.ns_per_frame = (uint32_t)(elapsed_us * 1000 / max(result.frames, (uint32_t)1));
+    result.pixels_per_frame = (display.pixels_written - start_pixels) / max(result.frames, (uint32_t)1);
+
+    Serial.printf("%-16s frames=%-5u ns/frame=%-9u pixels/frame=%u\n",
+        result.name, (unsigned)result.frames, (unsigned)result.ns_per_frame, (unsigned)result.pixels_per_frame);
+
+}
+
+
+// --- Benchmark Functions ---
+
+/// @brief Runs every benchmark case, and prints the results to the serial port.
+/// @param results Array of `RENDER_BENCHMARK_CASES` results to fill.
+/// @return The number of cases run.
+uint8_t renderBenchmarkRun(RenderBenchmarkResult* results) {
+
+    RenderBenchmarkResult* bench = results;
+    int64_t start_us;
+    uint32_t start_pixels;
+    char buf_a[16];
+    char buf_b[16];
+    char buf_c[4];
+    char buf_d[4];
+
+    display.firstPage();
+    display.setTextColor(GxEPD_BLACK);
+    Serial.printf("Render benchmark\n");
+
+    // Reference, a square of a fixed size.
+    benchmarkStart(*bench, "reference", start_us, start_pixels);
+    for (uint8_t i = 0; i < 100; i++) {
+        display.fillRect(0, 0, 64, 64, GxEPD_BLACK);
+        bench->frames++;
+    }
+    benchmarkEnd(*bench++, start_us, start_pixels);
+
+    // Borders, a single frame.
+    benchmarkStart(*bench, "borders", start_us, start_pixels);
+    displayRenderBorders();
+    bench->frames++;
+    benchmarkEnd(*bench++, start_us, start_pixels);
+
+    // Status bar, with every battery percent, icon and last sync time.
+    benchmarkStart(*bench, "status_bar", start_us, start_pixels);
+    for (uint16_t i = 0; i < 24 * 60; i++) {
+        sprintf(buf_a, "%d%%", i % 101);
+        sprintf(buf_b, "%dd", i % 1000);
+        sprintf(buf_c, "%02d", i / 60);
+        sprintf(buf_d, "%02d", i % 60);
+        displayRenderStatusBar(buf_a, buf_b, buf_c, buf_d, i % 5);
+        bench->frames++;
+    }
+    benchmarkEnd(*bench++, start_us, start_pixels);
+
+    // Time, every minute of the day.
+    benchmarkStart(*bench, "time", start_us, start_pixels);
+    for (uint16_t i = 0; i < 24 * 60; i++) {
+        sprintf(buf_c, "%02d", i / 60);
+        sprintf(buf_d, "%02d", i % 60);
+        displayRenderTime(buf_c, buf_d);
+        bench->frames++;
+    }
+    benchmarkEnd(*bench++, start_us, start_pixels);
+
+    // Date, every month and day number.
+    benchmarkStart(*bench, "date", start_us, start_pixels);
+    for (uint8_t month = 1; month <= 12; month++) {
+        for (uint8_t day = 1; day <= 31; day++) {
+            sprintf(buf_a, "2024-%02d-%02d", month, day);
+            displayRenderDate(buf_a);
+            bench->frames++;
+        }
+    }
+    benchmarkEnd(*bench++, start_us, start_pixels);
+
+    // Seconds, every second of a minute.
+    benchmarkStart(*bench, "second", start_us, start_pixels);
+    for (uint8_t second = 0; second < 60; second++) {
+        displayRenderSecond(second);
+        bench->frames++;
+    }
+    benchmarkEnd(*bench++, start_us, start_pixels);
+
+    // Centered text, every two digit number.
+    benchmarkStart(*bench, "center_text", start_us, start_pixels);
+    display.setFont(&FreeMonoBold12pt7b);
+    for (uint8_t i = 0; i < 100; i++) {
+        sprintf(buf_c, "%02d", i);
+        displayCenterText(buf_c, 148, 64);
+        bench->frames++;
+    }
+    benchmarkEnd(*bench++, start_us, start_pixels);
+
+    // Bitmaps, every icon.
+    benchmarkStart(*bench, "xbitmap", start_us, start_pixels);
+    for (uint8_t i = 0; i < 5; i++) {
+        display.drawXBitmap(0, 1, battery_multiple_xbm_bits[i], battery_xbm_width, battery_xbm_height, GxEPD_BLACK);
+        bench->frames++;
+    }
+    display.drawXBitmap(236, 0, refresh_xbm_bits, refresh_xbm_width, refresh_xbm_height, GxEPD_BLACK);
+    bench->frames++;
+    benchmarkEnd(*bench++, start_us, start_pixels);
+
+    return bench - results;
+
+}
+
+#endif /* RENDER_BENCHMARK */
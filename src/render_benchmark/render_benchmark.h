@@ -0,0 +1,28 @@
+#ifndef RENDER_BENCHMARK_H
+#define RENDER_BENCHMARK_H
+
+// --- Libraries ---
+#include <Arduino.h>
+
+// --- Settings ---
+#include "settings.h"
+
+
+// --- Constants ---
+#define RENDER_BENCHMARK_CASES 8
+
+
+// --- Render Benchmark ---
+
+/// @brief The result of a benchmark case, averaged over its frames.
+struct RenderBenchmarkResult {
+    const char* name;
+    uint32_t frames;
+    uint32_t ns_per_frame;
+    uint32_t pixels_per_frame;
+};
+
+// --- Functions ---
+uint8_t renderBenchmarkRun(RenderBenchmarkResult* results);
+
+#endif /* RENDER_BENCHMARK_H */
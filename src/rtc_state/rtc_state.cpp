@@ -0,0 +1,72 @@
+#include "rtc_state.h"
+
+#include <esp_rom_crc.h>
+
+
+// --- Globals ---
+
+/*
+    Variables labelled with `RTC_NOINIT_ATTR` are stored in RTC FAST memory,
+    and as the "NOINIT" part suggests, are not cleared on resets.
+    (As opposed to `RTC_DATA_ATTR`, witch only persists after deep sleep.)
+*/
+RtcState RTC_NOINIT_ATTR rtc_state;
+
+
+// --- Helper Functions ---
+
+/// @brief Calculates the checksum of the state block, excluding the checksum itself.
+/// @return The CRC32 of the block. This is a ROM function, so it is safe to call from interrupts.
+static uint32_t IRAM_ATTR rtcStateChecksum() {
+
+    return esp_rom_crc32_le(0, (const uint8_t*)&rtc_state, offsetof(RtcState, crc));
+
+}
+
+
+// --- State Functions ---
+
+/// @brief Checks the layout and the checksum of the state block, without changing it.
+/// @return True if the block is valid.
+bool rtcStateValid() {
+
+    return rtc_state.magic == RTC_STATE_MAGIC &&
+        rtc_state.version == RTC_STATE_VERSION &&
+        rtc_state.crc == rtcStateChecksum();
+
+}
+
+/// @brief Validates the state block in a single pass, and wipes it if it can not be trusted.
+/// @param trusted If false, the contents are wiped regardless. Should be false after a power on reset or crash.
+/// @return True if the previous state was kept, false if it was wiped.
+bool rtcStateLoad(bool trusted) {
+
+    if (trusted && rtcStateValid()) return true;
+
+    rtcStateReset();
+    return false;
+
+}
+
+/// @brief Clears all persistent variables, and marks the block as valid.
+void rtcStateReset() {
+
+    memset(&rtc_state, 0, sizeof(rtc_state));
+    rtc_state.magic = RTC_STATE_MAGIC;
+    rtc_state.version = RTC_STATE_VERSION;
+
+    /*
+        As there will be a resync after a reset, the last sync, battery
+        and wifi fields are filled in before they are first displayed.
+    */
+
+    rtcStateCommit();
+
+}
+
+/// @brief Updates the checksum. Has to be called before every deep sleep or restart.
+void IRAM_ATTR rtcStateCommit() {
+
+    rtc_state.crc = rtcStateChecksum();
+
+}
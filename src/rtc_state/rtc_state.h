@@ -0,0 +1,116 @@
+#ifndef RTC_STATE_H
+#define RTC_STATE_H
+
+// --- Libraries ---
+#include <Arduino.h>
+
+
+// --- Layout Identification ---
+
+/*
+    The magic number and the version are stored at the start of the block.
+    Increment the version every time the layout of `RtcState` changes,
+    so a new firmware never misreads a block written by an older one.
+*/
+#define RTC_STATE_MAGIC   0xC10C
+#define RTC_STATE_VERSION 8
+
+
+// --- State Block ---
+
+/*
+    Every variable that has to persist between boots lives in this struct.
+    Fields use the smallest width that fits their range, and are grouped by
+    width, from the smallest, so there is no padding inside the checksum.
+    New fields go to the end of the group of their width, and the size
+    below is updated, the check fails if a field adds padding. Strings are
+    not stored, they are formatted from the numeric values when needed.
+*/
+#define RTC_STATE_SIZE 84
+struct RtcState {
+
+    // Header, padded to 4 bytes
+    uint16_t magic;
+    uint8_t version;
+    uint8_t reserved;
+
+    // Modes
+    uint8_t desired_mode;
+    uint8_t mode;
+
+    // Last sync
+    uint8_t last_sync_hour;
+    uint8_t last_sync_minute;
+
+    // Battery and WiFi
+    uint8_t battery_percent;
+    uint8_t battery_status;
+    uint8_t charging;
+    int8_t wifi_strength;
+
+    // Clock face on the display, see `clock_format.cpp`
+    uint8_t shown_month;
+    uint8_t shown_day;
+    uint8_t shown_hour;
+    uint8_t shown_minute;
+    uint8_t shown_battery_percent;
+    uint8_t shown_battery_icon;
+    uint8_t shown_last_sync_hour;
+    uint8_t shown_last_sync_minute;
+
+    // Time shift compensation
+    int16_t time_correction_step;
+    uint16_t time_shift_samples;
+    uint16_t time_deviation_samples;
+
+    // Energy ledger estimates, see `energy_ledger.cpp`
+    uint16_t ledger_soc;
+    uint16_t ledger_days_remaining;
+
+    // Clock face on the display
+    uint16_t shown_year;
+    uint16_t shown_days_remaining;
+
+    // Energy ledger time not counted in whole seconds yet
+    uint16_t ledger_remainder_ms;
+
+    // Time shift compensation averages
+    int32_t time_shift_average;
+    int32_t time_deviation_average;
+
+    // Time zone offsets in seconds, and UTC times of the transitions, see `time_zone.cpp`
+    int32_t time_zone_offset;
+    int32_t time_zone_next_offset;
+    uint32_t time_zone_last_change;
+    uint32_t time_zone_next_change;
+
+    // Energy ledger accumulators
+    uint32_t ledger_charge;
+    uint32_t ledger_seconds;
+    uint32_t ledger_daily_charge;
+
+    // Counters
+    uint32_t boot_num;
+
+    // Last result of the stopper in milliseconds
+    uint32_t stopper_elapsed;
+
+    // Checksum of all the fields above, must be the last field.
+    uint32_t crc;
+
+};
+
+static_assert(sizeof(RtcState) == RTC_STATE_SIZE, "RtcState has padding, or RTC_STATE_SIZE is not updated!");
+
+
+// --- Globals ---
+extern RtcState rtc_state;
+
+
+// --- Functions ---
+bool rtcStateValid();
+bool rtcStateLoad(bool trusted);
+void rtcStateReset();
+void IRAM_ATTR rtcStateCommit();
+
+#endif /* RTC_STATE_H */
@@ -1,3 +1,5 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
 
 // --- Behaviour ---
 
@@ -60,21 +62,112 @@
 */
 #define REPORT_TELEMETRY
 
+/* 
+    Replace the display with a virtual one for development purposes.
+    Every refresh is written to the serial port as a PBM image, with
+    the kind of the refresh, the window and the SPI transfer size.
+    See `virtual_display.h` for details.
+*/
+//#define VIRTUAL_DISPLAY
+
+/* 
+    Run the render benchmark on every boot, before anything is displayed.
+    The results are printed to the serial port, see `render_benchmark.cpp`.
+    Needs the virtual display, to count the pixels written. The host tests
+    check the pixels and the relative times, this is for the time on the clock.
+*/
+//#define RENDER_BENCHMARK
+
+/* 
+    Print the time from the start of the application to `setup()`, the
+    time spent awake, and the heap and stack usage before every deep sleep.
+    Used to check that boots without a sync never start the networking,
+    and that `setup()` fits the stack of a fast boot.
+    Modes requested by a button also print the time from the press to
+    the start of the mode, and to the end of its first refresh.
+*/
+//#define BOOT_PROFILE
+
+/* 
+    Skip the Arduino runtime initialization on the minute boots in NORMAL
+    mode, and run `setup()` right away. See `__wrap_initArduino` in
+    `main.cpp`. The `fast` field of the boot profile shows if it was used,
+    and `to_setup` the time it saves.
+*/
+#define FAST_BOOT
+
+/* 
+    Render the clock face of the next minute while the display refreshes,
+    and keep it in the frame buffer during deep sleep. The next boot only
+    sends it, if nothing else changed. The `render` field of the boot
+    profile shows the render time left at the start of the boot.
+*/
+#define RENDER_AHEAD
+
+/* 
+    Wake the display from deep sleep without a full initialization, if the
+    last boot hibernated it, and there is no wipe. Modes with a wipe, and
+    boots after a reset always initialize it fully. Has no effect with
+    AUX_FOR_DISP, as the display is not powered between boots.
+*/
+#define WARM_DISPLAY_INIT
+
 // --- General Settings ---
 
 #define LOOP_WAIT_TIME          20                             // The amount of time to wait im miliseconds per loop while waiting for something.
+#define BUTTON_DEBOUNCE_TIME    50                             // The buttons have to be released for this many miliseconds, before they are used again.
+
+#define DISPLAY_SPI_FREQUENCY   20000000                       // SPI clock of the display in Hz. The SSD1680 controller accepts writes up to 20MHz.
+#define DISPLAY_BUSY_SLEEP      1000                           // The longest light sleep in milliseconds while the display is refreshing. The end of the refresh wakes up sooner.
+#define TASK_GRAPH_STACK_SIZE   4096                           // Stack size in bytes of the tasks running the boot steps.
 
 #define SNTP_1                  "0.pool.ntp.org"               // Primary SNTP server.
 #define SNTP_2                  "1.pool.ntp.org"               // Secondary SNTP server.
-#define TIMEZONE                "CET-1CEST,M3.5.0,M10.5.0/3"   // Time zone for the clock. Here I'm using Budapest time.
+#define TIMEZONE                "CET-1CEST,M3.5.0,M10.5.0/3"   // Time zone for the clock as a POSIX TZ string, see `time_zone.h`. Here I'm using Budapest time.
+
+#define BATTERY_CURVE           battery_curve_lipo             // The discharge curve of the cell chemistry, from `battery_curves.h`.
 
 #define ADC_FACTOR              2                              // The factor to multiply the measured voltage with. Depends on the voltage divider.
-#define ADC_OVER_SAMPLE_COUNT   16                             // How many times to sample and average the 
+#define ADC_OVER_SAMPLE_COUNT   64                             // How many samples to take of the battery voltage with DMA.
+#define ADC_TRIM_COUNT          16                             // How many of the lowest, and highest samples to discard before averaging.
+#define ADC_SAMPLE_FREQUENCY    80000                          // The sampling frequency in Hz. The whole measurement takes ADC_OVER_SAMPLE_COUNT / ADC_SAMPLE_FREQUENCY seconds.
+#define ADC_SETTLE_TIME         200                            // Time in microseconds for the voltage divider to settle after the aux power is turned on.
+#define ADC_READ_TIMEOUT        10                             // The maximum time in milliseconds to wait for the samples.
 
 #define FULL_BATTERY_TOLERANCE  0                              // How much off can the battery voltage be from full, to be still considered as full.
 #define CRITICAL_BATTERY_LEVEL  3500                           // Below this battery voltage, critical mode will be activated.
 
-#define OMIT_SLEEP              1                              // If there are less than this many seconds to the minute, we wait instead of going to sleep.
-#define SLEEP_MARGIN            100                            // The processor wakes this many milliseconds up before the designated update time.
+#define OMIT_SLEEP              1                              // If there are less than this many seconds to the minute, the next minute is loaded into the display, and its refresh waits for the minute.
+#define SLEEP_MARGIN            100                            // The processor wakes this many milliseconds up before the designated update time. To start the refresh on the minute, it has to cover the boot, the render and the transfer, see `refresh_lag` of the boot profile.
+
+#define MAX_DISPLAYED_SECONDS   60                             // The maximum number of seconds to count out in SECONDS mode.
+
+#define STOPPER_UPDATE_EVERY    10                             // Refresh the elapsed time this often in seconds while the stopper is running.
+#define STOPPER_IDLE_TIMEOUT    30                             // Leave STOPPER mode after this many seconds if it was not started.
+#define STOPPER_MAX_MINUTES     60                             // Stop the stopper automatically after this many minutes.
+
+
+// --- Power Model ---
+
+/*
+    These values are used to estimate the state of charge, and the days
+    remaining, by charging every boot with a modelled cost.
+    The currents are rough estimates, measure them on your own board for
+    better results. The voltage measurements correct the estimate over time.
+*/
+
+#define BATTERY_CAPACITY                1000     // Capacity of the battery in mAh.
+
+#define POWER_BOOT_TIME                 120      // Time in milliseconds from a wakeup to `setup()`, not measured by the firmware.
+#define POWER_AWAKE_CURRENT             22       // Current in mA while the processor is awake.
+#define POWER_WIFI_CURRENT              80       // Additional current in mA while WiFi is on.
+#define POWER_ADC_CHARGE                300      // Charge in microcoulombs used by one battery measurement.
+#define POWER_FULL_REFRESH_CURRENT      8        // Additional current in mA during a full refresh.
+#define POWER_PARTIAL_REFRESH_CURRENT   5        // Additional current in mA during a partial refresh.
+#define POWER_SLEEP_CURRENT             25       // Current in uA in deep sleep.
+
+#define POWER_VOLTAGE_WEIGHT            25       // How much the voltage based estimate corrects the ledger, in percent.
+#define POWER_REANCHOR_THRESHOLD        20       // If the voltage shows this many percent more than the ledger, the battery was charged.
+
 
-#define MAX_DISPLAYED_SECONDS   10                             // The maximum number of seconds to count out in USER mode.
\ No newline at end of file
+#endif /* SETTINGS_H */
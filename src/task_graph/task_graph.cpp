@@ -0,0 +1,144 @@
+#include "task_graph.h"
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+
+
+// --- Jobs ---
+
+/// @brief Everything the task of a node needs.
+struct TaskGraphJob {
+    const TaskGraphNode* node;
+    TaskGraphRecord* record;
+    EventGroupHandle_t done;
+    EventBits_t bit;
+    EventBits_t depends;
+    int64_t start_time;
+};
+
+
+// --- Helper Functions ---
+
+/// @brief Runs the node of a job, after the nodes it depends on are done.
+/// Without an event group, every node runs inline, and the dependencies are already done.
+/// @param job The job of the node.
+static void taskGraphRunJob(TaskGraphJob* job) {
+
+    if (job->depends && job->done) xEventGroupWaitBits(job->done, job->depends, pdFALSE, pdTRUE, portMAX_DELAY);
+    job->record->start_us = esp_timer_get_time() - job->start_time;
+    job->node->run();
+    job->record->end_us = esp_timer_get_time() - job->start_time;
+
+    if (job->done) xEventGroupSetBits(job->done, job->bit);
+
+}
+
+/// @brief The task of a node.
+/// @param parameter The job of the node.
+static void taskGraphTask(void* parameter) {
+
+    taskGraphRunJob((TaskGraphJob*)parameter);
+    vTaskDelete(NULL);
+
+}
+
+/// @brief Calculates the sum of the run times along the longest chain ending with a node.
+/// @return The sum in microseconds.
+static uint32_t taskGraphChain(const TaskGraphNode* nodes, uint8_t count, uint8_t enabled, const TaskGraphRecord* records, uint8_t index) {
+
+    uint32_t longest = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (!(nodes[index].depends & enabled & (1 << i))) continue;
+        longest = max(longest, taskGraphChain(nodes, count, enabled, records, i));
+    }
+    return longest + records[index].end_us - records[index].start_us;
+
+}
+
+
+// --- Task Graph Functions ---
+
+/// @brief Runs the enabled nodes of a graph, each as soon as its dependencies are done, and waits for all of them.
+/// @param nodes The nodes, the dependencies must not form a cycle.
+/// @param count The number of nodes, at most `TASK_GRAPH_MAX_NODES`.
+/// @param enabled Mask of the nodes to run.
+/// @param records Filled with the times of the nodes. Disabled nodes are zero.
+/// @return The critical path, and the timing of the run.
+TaskGraphResult taskGraphRun(const TaskGraphNode* nodes, uint8_t count, uint8_t enabled, TaskGraphRecord* records) {
+
+    TaskGraphJob jobs[TASK_GRAPH_MAX_NODES];
+    TaskGraphResult result = { 0, 0, 0 };
+    const EventGroupHandle_t done = xEventGroupCreate();
+    const UBaseType_t priority = uxTaskPriorityGet(NULL);
+    const int64_t start_time = esp_timer_get_time();
+
+    // Start a task for every enabled node. They wait for their dependencies themselves.
+    // If a task can not be created, its node is run inline instead.
+    enabled &= (1 << count) - 1;
+    uint8_t inline_nodes = 0;
+    for (uint8_t i = 0; i < count; i++) {
+
+        records[i].start_us = 0;
+        records[i].end_us = 0;
+        if (!(enabled & (1 << i))) continue;
+
+        jobs[i].node = &nodes[i];
+        jobs[i].record = &records[i];
+        jobs[i].done = done;
+        jobs[i].bit = 1 << i;
+        jobs[i].depends = nodes[i].depends & enabled;
+        jobs[i].start_time = start_time;
+        if ((done == NULL) || (xTaskCreate(taskGraphTask, nodes[i].name, TASK_GRAPH_STACK_SIZE, &jobs[i], priority, NULL) != pdPASS)) {
+            inline_nodes |= 1 << i;
+        }
+
+    }
+
+    /*
+        The inline nodes run here, once the tasks of the others are started.
+        A node may depend on an inline node with a higher index, so each pass
+        only runs the nodes whose inline dependencies are done. The graph has
+        no cycles, so every pass runs at least one. The tasks they depend on
+        are waited for in `taskGraphRunJob`, as in the tasks.
+    */
+    while (inline_nodes) {
+        for (uint8_t i = 0; i < count; i++) {
+            if (!(inline_nodes & (1 << i)) || (jobs[i].depends & inline_nodes)) continue;
+            taskGraphRunJob(&jobs[i]);
+            inline_nodes &= ~(1 << i);
+        }
+    }
+
+    // The jobs live on this stack, so we have to wait for all of them.
+    if (done != NULL) {
+        if (enabled) xEventGroupWaitBits(done, enabled, pdFALSE, pdTRUE, portMAX_DELAY);
+        vEventGroupDelete(done);
+    }
+
+    // Follow the dependencies that ended last, back from the node that ended last.
+    int8_t current = -1;
+    for (uint8_t i = 0; i < count; i++) {
+        if ((enabled & (1 << i)) && ((current < 0) || (records[i].end_us >= records[current].end_us))) current = i;
+    }
+    if (current < 0) return result;
+    result.wall_us = records[current].end_us;
+
+    while (current >= 0) {
+        result.critical_path |= 1 << current;
+        const uint8_t depends = nodes[current].depends & enabled;
+        current = -1;
+        for (uint8_t i = 0; i < count; i++) {
+            if ((depends & (1 << i)) && ((current < 0) || (records[i].end_us >= records[current].end_us))) current = i;
+        }
+    }
+
+    // The best possible wall time is the longest chain of run times.
+    for (uint8_t i = 0; i < count; i++) {
+        if (enabled & (1 << i)) result.chain_us = max(result.chain_us, taskGraphChain(nodes, count, enabled, records, i));
+    }
+
+    return result;
+
+}
@@ -0,0 +1,53 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+// --- Libraries ---
+#include <Arduino.h>
+
+// --- Settings ---
+#include "settings.h"
+
+
+// --- Constants ---
+#define TASK_GRAPH_MAX_NODES 8
+
+
+// --- Task Graph ---
+
+/*
+    A small executor for independent pieces of work, that can wait for
+    each other. Every node runs in its own task, as soon as the nodes it
+    depends on are done, so waiting for peripherals in one node lets the
+    others run. The caller blocks until all enabled nodes are done.
+    If a task can not be created, for example without free heap, its node
+    runs in the calling task instead, so the graph still finishes.
+
+    Dependencies are bit masks of node indices. Disabled nodes count as
+    done, so a node only waits for the nodes that actually run.
+*/
+
+/// @brief A piece of work, and the nodes it has to wait for.
+struct TaskGraphNode {
+    const char* name;
+    void (*run)();
+    uint8_t depends;
+};
+
+/// @brief The times a node started and ended at, in microseconds from the start of the graph.
+struct TaskGraphRecord {
+    uint32_t start_us;
+    uint32_t end_us;
+};
+
+/// @brief The summary of a run.
+struct TaskGraphResult {
+    uint8_t critical_path;  // Mask of the chain of nodes that ended last.
+    uint32_t wall_us;       // Time from the start to the end of the last node.
+    uint32_t chain_us;      // Sum of the run times along the longest chain, the best possible wall time.
+};
+
+
+// --- Functions ---
+TaskGraphResult taskGraphRun(const TaskGraphNode* nodes, uint8_t count, uint8_t enabled, TaskGraphRecord* records);
+
+#endif /* TASK_GRAPH_H */
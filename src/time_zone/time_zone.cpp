@@ -0,0 +1,294 @@
+#include "time_zone.h"
+
+#include <ctype.h>
+
+#include "rtc_state/rtc_state.h"
+
+
+/*
+    Local time is calculated from the UTC time with integers only,
+    instead of `tzset` and `localtime_r`, that evaluate the TZ rules
+    on every call.
+
+    The offset in effect, and the times of the DST transitions around it
+    are kept in the persistent state. They are calculated from `TIMEZONE`
+    only when the time leaves that range, that is twice a year, after a
+    reset, or when a sync moves the clock across a transition.
+*/
+
+
+// --- Constants ---
+#define SECONDS_PER_DAY         86400
+#define DEFAULT_RULE_TIME       7200
+#define NO_TRANSITION           0xFFFFFFFF
+
+
+// --- Calendar Functions ---
+
+/// @brief Counts the days from 1970-01-01 to a date of the proleptic Gregorian calendar.
+/// @return The number of days, negative before 1970.
+static int32_t daysFromCivil(int32_t year, uint8_t month, uint8_t day) {
+
+    year -= month <= 2;
+    const int32_t era = (year >= 0 ? year : year - 399) / 400;
+    const uint32_t year_of_era = (uint32_t)(year - era * 400);
+    const uint32_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const uint32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + (int32_t)day_of_era - 719468;
+
+}
+
+/// @brief Converts days from 1970-01-01 to a date of the proleptic Gregorian calendar.
+static void civilFromDays(int32_t days, int32_t& year, uint8_t& month, uint8_t& day) {
+
+    days += 719468;
+    const int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const uint32_t day_of_era = (uint32_t)(days - era * 146097);
+    const uint32_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const uint32_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const uint32_t month_index = (5 * day_of_year + 2) / 153;
+    day = day_of_year - (153 * month_index + 2) / 5 + 1;
+    month = month_index < 10 ? month_index + 3 : month_index - 9;
+    year = (int32_t)year_of_era + era * 400 + (month <= 2);
+
+}
+
+/// @brief Gets the day of the week of a day.
+/// @return 0 for Sunday, up to 6 for Saturday.
+static uint8_t weekdayFromDays(int32_t days) {
+
+    // 1970-01-01 was a Thursday.
+    return (uint8_t)((days % 7 + 11) % 7);
+
+}
+
+static bool isLeapYear(int32_t year) {
+
+    return (year % 4 == 0) && ((year % 100 != 0) || (year % 400 == 0));
+
+}
+
+
+// --- Parsing Functions ---
+
+/// @brief Skips a zone name, either letters, or anything between angle brackets.
+/// @return False if there is no name.
+static bool parseName(const char*& p) {
+
+    const char* start = p;
+    if (*p == '<') {
+        while (*p && *p != '>') p++;
+        if (*p != '>') return false;
+        p++;
+        return p - start > 2;
+    }
+    while (isalpha((unsigned char)*p)) p++;
+    return p - start >= 3;
+
+}
+
+/// @brief Parses a time as `[+|-]hh[:mm[:ss]]`.
+/// @param seconds The signed time in seconds.
+/// @return False if there is no number.
+static bool parseTime(const char*& p, int32_t& seconds) {
+
+    int32_t sign = 1;
+    if (*p == '+' || *p == '-') sign = (*p++ == '-') ? -1 : 1;
+    if (!isdigit((unsigned char)*p)) return false;
+
+    int32_t parts[3] = { 0, 0, 0 };
+    for (uint8_t i = 0; i < 3; i++) {
+        while (isdigit((unsigned char)*p)) parts[i] = parts[i] * 10 + (*p++ - '0');
+        if (*p != ':' || i == 2) break;
+        p++;
+    }
+    seconds = sign * (parts[0] * 3600 + parts[1] * 60 + parts[2]);
+    return true;
+
+}
+
+/// @brief Parses an unsigned number.
+static bool parseNumber(const char*& p, uint16_t& value) {
+
+    if (!isdigit((unsigned char)*p)) return false;
+    value = 0;
+    while (isdigit((unsigned char)*p)) value = value * 10 + (*p++ - '0');
+    return true;
+
+}
+
+/// @brief Parses a transition rule, see `TimeZoneRule`.
+static bool parseRule(const char*& p, TimeZoneRule& rule) {
+
+    uint16_t month, week, weekday;
+    rule.time = DEFAULT_RULE_TIME;
+    if (*p == 'M') {
+        p++;
+        rule.kind = 'M';
+        if (!parseNumber(p, month) || *p++ != '.') return false;
+        if (!parseNumber(p, week) || *p++ != '.') return false;
+        if (!parseNumber(p, weekday)) return false;
+        if (month < 1 || month > 12 || week < 1 || week > 5 || weekday > 6) return false;
+        rule.month = month;
+        rule.week = week;
+        rule.weekday = weekday;
+    } else {
+        rule.kind = (*p == 'J') ? 'J' : 'D';
+        if (*p == 'J') p++;
+        if (!parseNumber(p, rule.day)) return false;
+        if ((rule.kind == 'J') ? (rule.day < 1 || rule.day > 365) : (rule.day > 365)) return false;
+    }
+    if (*p == '/') {
+        p++;
+        if (!parseTime(p, rule.time)) return false;
+    }
+    return true;
+
+}
+
+/// @brief Parses a POSIX TZ string, like `CET-1CEST,M3.5.0,M10.5.0/3`.
+/// @param tz The TZ string.
+/// @param spec The parsed zone.
+/// @return False if the string is invalid. The zone is UTC then.
+bool timeZoneParse(const char* tz, TimeZoneSpec& spec) {
+
+    const char* p = tz;
+    int32_t offset;
+    spec.std_offset = 0;
+    spec.dst_offset = 0;
+    spec.has_dst = false;
+
+    // The offsets of POSIX are west of UTC.
+    if (!parseName(p) || !parseTime(p, offset)) return false;
+    spec.std_offset = -offset;
+    spec.dst_offset = spec.std_offset;
+    if (*p == '\0') return true;
+
+    // Daylight saving time is one hour ahead, unless given.
+    if (!parseName(p)) return false;
+    spec.dst_offset = spec.std_offset + 3600;
+    if (*p != ',' && *p != '\0') {
+        if (!parseTime(p, offset)) return false;
+        spec.dst_offset = -offset;
+    }
+
+    // Without rules, the US rules are the default, as in newlib.
+    if (*p == '\0') {
+        spec.start = { 'M', 3, 2, 0, 0, DEFAULT_RULE_TIME };
+        spec.end = { 'M', 11, 1, 0, 0, DEFAULT_RULE_TIME };
+        spec.has_dst = true;
+        return true;
+    }
+
+    if (*p++ != ',' || !parseRule(p, spec.start)) return false;
+    if (*p++ != ',' || !parseRule(p, spec.end)) return false;
+    spec.has_dst = (*p == '\0');
+    return spec.has_dst;
+
+}
+
+
+// --- Transition Functions ---
+
+/// @brief Calculates the local time of a transition in a year.
+/// @return Seconds from 1970-01-01 in the local time before the transition.
+static int64_t ruleLocalTime(const TimeZoneRule& rule, int32_t year) {
+
+    int32_t days = daysFromCivil(year, 1, 1);
+    if (rule.kind == 'M') {
+
+        // The first matching weekday of the month, then the week. The fifth week is the last.
+        const int32_t first = daysFromCivil(year, rule.month, 1);
+        const int32_t next_month = (rule.month == 12) ? daysFromCivil(year + 1, 1, 1) : daysFromCivil(year, rule.month + 1, 1);
+        days = first + (rule.weekday + 7 - weekdayFromDays(first)) % 7 + (rule.week - 1) * 7;
+        while (days >= next_month) days -= 7;
+
+    } else if (rule.kind == 'J') {
+        days += rule.day - 1 + ((rule.day >= 60) && isLeapYear(year));
+    } else {
+        days += rule.day;
+    }
+    return (int64_t)days * SECONDS_PER_DAY + rule.time;
+
+}
+
+/// @brief Makes sure the persistent offset and transitions contain the time.
+/// @param now The UTC time.
+void timeZoneUpdate(time_t now) {
+
+    if ((now >= (time_t)rtc_state.time_zone_last_change) && ((uint32_t)now < rtc_state.time_zone_next_change)) return;
+
+    TimeZoneSpec spec;
+    timeZoneParse(TIMEZONE, spec);
+    rtc_state.time_zone_offset = spec.std_offset;
+    rtc_state.time_zone_next_offset = spec.std_offset;
+    rtc_state.time_zone_last_change = 0;
+    rtc_state.time_zone_next_change = NO_TRANSITION;
+    if (!spec.has_dst) return;
+
+    // Collect the transitions of the year, and the ones around it, in order.
+    int32_t year;
+    uint8_t month, day;
+    civilFromDays((int32_t)(((int64_t)now + spec.std_offset) / SECONDS_PER_DAY), year, month, day);
+    int64_t times[6];
+    int32_t offsets[6];
+    for (uint8_t i = 0; i < 3; i++) {
+        times[2 * i] = ruleLocalTime(spec.start, year - 1 + i) - spec.std_offset;
+        offsets[2 * i] = spec.dst_offset;
+        times[2 * i + 1] = ruleLocalTime(spec.end, year - 1 + i) - spec.dst_offset;
+        offsets[2 * i + 1] = spec.std_offset;
+    }
+    for (uint8_t i = 1; i < 6; i++) {
+        for (uint8_t j = i; j > 0 && times[j - 1] > times[j]; j--) {
+            const int64_t time = times[j]; times[j] = times[j - 1]; times[j - 1] = time;
+            const int32_t offset = offsets[j]; offsets[j] = offsets[j - 1]; offsets[j - 1] = offset;
+        }
+    }
+
+    // Before the first transition, the other offset was in effect.
+    rtc_state.time_zone_offset = (offsets[0] == spec.std_offset) ? spec.dst_offset : spec.std_offset;
+    for (uint8_t i = 0; i < 6; i++) {
+        if (times[i] <= (int64_t)now) {
+            rtc_state.time_zone_offset = offsets[i];
+            rtc_state.time_zone_last_change = (uint32_t)max(times[i], (int64_t)0);
+        } else {
+            rtc_state.time_zone_next_offset = offsets[i];
+            rtc_state.time_zone_next_change = (uint32_t)min(times[i], (int64_t)NO_TRANSITION);
+            break;
+        }
+    }
+
+}
+
+/// @brief Converts a UTC time to local time, like `localtime_r`, with the `TIMEZONE` of the settings.
+/// @param now The UTC time.
+/// @param result The local time.
+void timeZoneLocal(time_t now, struct tm* result) {
+
+    timeZoneUpdate(now);
+
+    const int64_t local = (int64_t)now + rtc_state.time_zone_offset;
+    int32_t days = (int32_t)(local / SECONDS_PER_DAY);
+    int32_t seconds = (int32_t)(local % SECONDS_PER_DAY);
+    if (seconds < 0) {
+        seconds += SECONDS_PER_DAY;
+        days--;
+    }
+
+    int32_t year;
+    uint8_t month, day;
+    civilFromDays(days, year, month, day);
+
+    result->tm_sec = seconds % 60;
+    result->tm_min = (seconds / 60) % 60;
+    result->tm_hour = seconds / 3600;
+    result->tm_mday = day;
+    result->tm_mon = month - 1;
+    result->tm_year = year - 1900;
+    result->tm_wday = weekdayFromDays(days);
+    result->tm_yday = days - daysFromCivil(year, 1, 1);
+
+    // Daylight saving time is the offset ahead of the other one.
+    result->tm_isdst = rtc_state.time_zone_offset > rtc_state.time_zone_next_offset;
+
+}
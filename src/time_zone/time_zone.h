@@ -0,0 +1,46 @@
+#ifndef TIME_ZONE_H
+#define TIME_ZONE_H
+
+// --- Libraries ---
+#include <Arduino.h>
+#include <time.h>
+
+// --- Settings ---
+#include "settings.h"
+
+
+// --- Rules ---
+
+/*
+    A DST transition rule of a POSIX TZ string, after the comma:
+        Mm.w.d  The d-th weekday (0 is Sunday) of week w (5 is the last) of month m.
+        Jn      Day n from 1 to 365, February 29 is never counted.
+        n       Day n from 0 to 365, February 29 is counted.
+    Optionally followed by `/time`, the local time of the transition,
+    2:00:00 by default.
+*/
+struct TimeZoneRule {
+    char kind;          // 'M', 'J' or 'D' for the plain day number.
+    uint8_t month;
+    uint8_t week;
+    uint8_t weekday;
+    uint16_t day;
+    int32_t time;       // Seconds from the local midnight.
+};
+
+/// @brief A parsed POSIX TZ string. Offsets are in seconds east of UTC.
+struct TimeZoneSpec {
+    int32_t std_offset;
+    int32_t dst_offset;
+    bool has_dst;
+    TimeZoneRule start;
+    TimeZoneRule end;
+};
+
+
+// --- Functions ---
+bool timeZoneParse(const char* tz, TimeZoneSpec& spec);
+void timeZoneUpdate(time_t now);
+void timeZoneLocal(time_t now, struct tm* result);
+
+#endif /* TIME_ZONE_H */
@@ -0,0 +1,133 @@
+#include "wifi_sync.h"
+
+
+/*
+    Everything that needs the network lives in this file, so the WiFi,
+    LwIP and HTTP headers are only included here. The stacks are brought
+    up by `wifiSyncStart`, witch is only called on the boots that sync,
+    all other boots never touch them.
+
+    With `SKIP_SYNC`, nothing here is compiled, so the networking
+    libraries are not even linked into the firmware.
+*/
+#if !defined(SKIP_SYNC)
+
+// --- Libraries ---
+#include <WiFi.h>
+#include <HTTPClient.h>
+
+#include <esp_sntp.h>
+
+// --- Secrets ---
+#include "wifi_secret.h"
+#include "rtc_state/rtc_state.h"
+
+
+// --- Sync Functions ---
+
+/// @brief Configures the SNTP time sync, and starts connecting to the WiFi network.
+/// @param sync_callback Called when the time is synced.
+void wifiSyncStart(void (*sync_callback)(timeval*)) {
+
+    // Configure SNTP time sync.
+    sntp_setoperatingmode(SNTP_SYNC_MODE_IMMED);
+    sntp_setservername(1, SNTP_1);
+    sntp_setservername(2, SNTP_2);
+    sntp_set_time_sync_notification_cb(sync_callback);
+    sntp_init();
+
+    // Set up WiFi. Nothing is written to flash.
+    WiFi.persistent(false);
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(ssid, password);
+
+}
+
+/// @brief Gets the strength of the connected network.
+/// @return The RSSI in dBm.
+int8_t wifiSyncStrength() {
+
+    return WiFi.RSSI();
+
+}
+
+/// @brief Makes an HTTP POST request for data logging, if enabled.
+/// @param sync_duration_ms The time it took to sync.
+/// @param time_shift_ms The time shift measured by this sync.
+/// @param time_deviation_ms The deviation from the average time shift.
+void wifiSyncReport(int32_t sync_duration_ms, int32_t time_shift_ms, int32_t time_deviation_ms) {
+
+    #if defined(REPORT_TELEMETRY)
+
+        /* 
+            The buffer neds to be big enough to fit all the data.
+            The size of the different data parts:
+                - Outline:              250
+                - UUID:                 36
+                - BatteryLevel:         4
+                - BootNum:              10
+                - currentMode:          3
+                - timeShift:            10
+                - timeShiftAverage:     10
+                - timeShiftSamples:     10
+                - syncDuration:         10
+                - wifiStrength:         4
+                - timeDeviation:        10
+                - timeDeviationAverage: 10
+                - timeDeviationSamples: 10
+                - stateOfCharge:        3
+                - daysRemaining:        5
+                - dailyCharge:          10
+            Total:                      395
+        */
+        char strf_post_buf[400];
+
+        // Fill the buffer with the formatted string.
+        sprintf(strf_post_buf,
+            "{"
+                "\"uuid\":\"%s\","
+                "\"bootNum\":\"%d\","
+                "\"currentMode\":\"%d\","
+                "\"batteryLevel\":\"%d%%\","
+                "\"wifiStrength\":\"%d\","
+                "\"syncDuration\":\"%d\","
+                "\"timeShift\":\"%d\","
+                "\"timeShiftAverage\":\"%d\","
+                "\"timeShiftSamples\":\"%d\","
+                "\"timeDeviation\":\"%d\","
+                "\"timeDeviationAverage\":\"%d\","
+                "\"timeDeviationSamples\":\"%d\","
+                "\"stateOfCharge\":\"%d\","
+                "\"daysRemaining\":\"%d\","
+                "\"dailyCharge\":\"%d\""
+            "}",
+            uuid, rtc_state.boot_num, rtc_state.mode, rtc_state.battery_percent, rtc_state.wifi_strength,
+            sync_duration_ms,
+            time_shift_ms, rtc_state.time_shift_average, rtc_state.time_shift_samples,
+            time_deviation_ms, rtc_state.time_deviation_average, rtc_state.time_deviation_samples,
+            rtc_state.ledger_soc / 10, rtc_state.ledger_days_remaining, rtc_state.ledger_daily_charge
+        );
+
+        // Create an http client.
+        HTTPClient http;
+
+        // Configure url and data to send.
+        http.begin(reportingUrl);
+        http.addHeader("Content-Type", "application/json");
+        int httpRes = http.POST(strf_post_buf);
+
+        // Close the connection.
+        http.end();
+
+    #endif /* REPORT_TELEMETRY */
+
+}
+
+/// @brief Turns off the WiFi.
+void wifiSyncStop() {
+
+    WiFi.mode(WIFI_OFF);
+
+}
+
+#endif /* !SKIP_SYNC */
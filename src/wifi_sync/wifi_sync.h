@@ -0,0 +1,16 @@
+#ifndef WIFI_SYNC_H
+#define WIFI_SYNC_H
+
+// --- Libraries ---
+#include <Arduino.h>
+
+// --- Settings ---
+#include "settings.h"
+
+// --- Functions ---
+void wifiSyncStart(void (*sync_callback)(timeval*));
+int8_t wifiSyncStrength();
+void wifiSyncReport(int32_t sync_duration_ms, int32_t time_shift_ms, int32_t time_deviation_ms);
+void wifiSyncStop();
+
+#endif /* WIFI_SYNC_H */
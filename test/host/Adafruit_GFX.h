@@ -0,0 +1,199 @@
+#ifndef HOST_ADAFRUIT_GFX_H
+#define HOST_ADAFRUIT_GFX_H
+
+/*
+    Stand-in for Adafruit GFX, for the host tests. The library needs the
+    SPI and I2C drivers of the core, so the part used by `display_helper`
+    is repeated here instead. The drawing follows the library step by
+    step, including its quirks, so the pixels and their count are the
+    same as on the clock:
+        - Text wraps at the right edge, unless `setTextWrap(false)`.
+        - Lines are drawn from both ends, so a line of zero width is
+          2 pixels long, like `writeLine` does.
+    Only fonts with a size of 1 are supported, the clock uses no other.
+*/
+
+// --- Libraries ---
+#include <Arduino.h>
+#include <gfxfont.h>
+
+
+// --- Adafruit GFX ---
+class Adafruit_GFX : public Print {
+
+public:
+
+    Adafruit_GFX(int16_t w, int16_t h) : WIDTH(w), HEIGHT(h), _width(w), _height(h) {}
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+    // --- Shapes ---
+
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+
+        const bool steep = abs(y1 - y0) > abs(x1 - x0);
+        if (steep) { std::swap(x0, y0); std::swap(x1, y1); }
+        if (x0 > x1) { std::swap(x0, x1); std::swap(y0, y1); }
+
+        const int16_t dx = x1 - x0;
+        const int16_t dy = abs(y1 - y0);
+        const int16_t ystep = (y0 < y1) ? 1 : -1;
+        int16_t err = dx / 2;
+
+        for (; x0 <= x1; x0++) {
+            if (steep) drawPixel(y0, x0, color); else drawPixel(x0, y0, color);
+            err -= dy;
+            if (err < 0) { y0 += ystep; err += dx; }
+        }
+
+    }
+
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { drawLine(x, y, x + w - 1, y, color); }
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { drawLine(x, y, x, y + h - 1, color); }
+
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+
+        drawFastHLine(x, y, w, color);
+        drawFastHLine(x, y + h - 1, w, color);
+        drawFastVLine(x, y, h, color);
+        drawFastVLine(x + w - 1, y, h, color);
+
+    }
+
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+
+        for (int16_t i = x; i < x + w; i++) drawFastVLine(i, y, h, color);
+
+    }
+
+    void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+
+    void drawXBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w, int16_t h, uint16_t color) {
+
+        const int16_t byte_width = (w + 7) / 8;
+        uint8_t b = 0;
+        for (int16_t j = 0; j < h; j++, y++) {
+            for (int16_t i = 0; i < w; i++) {
+                if (i & 7) b >>= 1;
+                else b = pgm_read_byte(&bitmap[j * byte_width + i / 8]);
+                if (b & 0x01) drawPixel(x + i, y, color);
+            }
+        }
+
+    }
+
+    // --- Text ---
+
+    void setCursor(int16_t x, int16_t y) { _cursor_x = x; _cursor_y = y; }
+    int16_t getCursorX() const { return _cursor_x; }
+    int16_t getCursorY() const { return _cursor_y; }
+    void setTextColor(uint16_t color) { _text_color = color; }
+    void setTextWrap(bool wrap) { _wrap = wrap; }
+
+    void setFont(const GFXfont* font) {
+
+        // The baseline of the fonts is lower than the top of the built in one.
+        if (font && !_font) _cursor_y += 6;
+        else if (!font && _font) _cursor_y -= 6;
+        _font = font;
+
+    }
+
+    void getTextBounds(const char* str, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h) {
+
+        int16_t min_x = 0x7FFF, min_y = 0x7FFF, max_x = -1, max_y = -1;
+        *x1 = x; *y1 = y; *w = *h = 0;
+
+        for (; *str; str++) {
+            const GFXglyph* glyph = glyphOf(*str, x, y, true);
+            if (glyph == NULL) continue;
+            const int16_t gx1 = x + (int8_t)pgm_read_byte(&glyph->xOffset);
+            const int16_t gy1 = y + (int8_t)pgm_read_byte(&glyph->yOffset);
+            min_x = min(min_x, gx1);
+            min_y = min(min_y, gy1);
+            max_x = max(max_x, (int16_t)(gx1 + pgm_read_byte(&glyph->width) - 1));
+            max_y = max(max_y, (int16_t)(gy1 + pgm_read_byte(&glyph->height) - 1));
+            x += pgm_read_byte(&glyph->xAdvance);
+        }
+
+        if (max_x >= min_x) { *x1 = min_x; *w = max_x - min_x + 1; }
+        if (max_y >= min_y) { *y1 = min_y; *h = max_y - min_y + 1; }
+
+    }
+
+    using Print::write;
+    size_t write(uint8_t c) override {
+
+        const GFXglyph* glyph = glyphOf(c, _cursor_x, _cursor_y, false);
+        if (glyph == NULL) return 1;
+
+        const uint8_t* bitmap = (const uint8_t*)pgm_read_ptr(&_font->bitmap) + pgm_read_word(&glyph->bitmapOffset);
+        const uint8_t w = pgm_read_byte(&glyph->width);
+        const uint8_t h = pgm_read_byte(&glyph->height);
+        const int16_t x = _cursor_x + (int8_t)pgm_read_byte(&glyph->xOffset);
+        const int16_t y = _cursor_y + (int8_t)pgm_read_byte(&glyph->yOffset);
+
+        // Bits are packed without padding at the end of the rows.
+        uint8_t bits = 0, bit = 0;
+        for (uint8_t yy = 0; yy < h; yy++) {
+            for (uint8_t xx = 0; xx < w; xx++) {
+                if (!(bit++ & 7)) bits = pgm_read_byte(bitmap++);
+                if (bits & 0x80) drawPixel(x + xx, y + yy, _text_color);
+                bits <<= 1;
+            }
+        }
+
+        _cursor_x += pgm_read_byte(&glyph->xAdvance);
+        return 1;
+
+    }
+
+    // --- Rotation ---
+
+    void setRotation(uint8_t rotation) {
+
+        _rotation = rotation & 3;
+        _width = (_rotation & 1) ? HEIGHT : WIDTH;
+        _height = (_rotation & 1) ? WIDTH : HEIGHT;
+
+    }
+
+    uint8_t getRotation() const { return _rotation; }
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+
+protected:
+
+    const int16_t WIDTH, HEIGHT;
+    int16_t _width, _height;
+
+private:
+
+    /// @brief Finds the glyph of a character, and moves the position to the next line if it would not fit.
+    /// @param bounds If true, glyphs without a bitmap can wrap too, as in the bounds of the library.
+    /// @return The glyph, or NULL if it is not in the font, or it is a control character.
+    const GFXglyph* glyphOf(uint8_t c, int16_t& x, int16_t& y, bool bounds) {
+
+        const uint8_t y_advance = pgm_read_byte(&_font->yAdvance);
+        if (c == '\n') { x = 0; y += y_advance; return NULL; }
+        if ((c == '\r') || (c < pgm_read_word(&_font->first)) || (c > pgm_read_word(&_font->last))) return NULL;
+
+        const GFXglyph* glyph = (const GFXglyph*)pgm_read_ptr(&_font->glyph) + (c - pgm_read_word(&_font->first));
+        const uint8_t w = pgm_read_byte(&glyph->width);
+        if (_wrap && (bounds || ((w > 0) && (pgm_read_byte(&glyph->height) > 0))) && (x + (int8_t)pgm_read_byte(&glyph->xOffset) + w > _width)) {
+            x = 0;
+            y += y_advance;
+        }
+        return glyph;
+
+    }
+
+    const GFXfont* _font = NULL;
+    uint8_t _rotation = 0;
+    int16_t _cursor_x = 0, _cursor_y = 0;
+    uint16_t _text_color = 0xFFFF;
+    bool _wrap = true;
+
+};
+
+#endif /* HOST_ADAFRUIT_GFX_H */
@@ -0,0 +1,89 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+/*
+    Stand-in for the Arduino core in the host tests, see `[env:native]`
+    in `platformio.ini`. Only what the tested sources use is declared.
+    The memory attributes of the ESP32 have no meaning on the host.
+*/
+
+// --- Libraries ---
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdarg.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "pgmspace.h"
+
+
+// --- Memory Attributes ---
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+
+// --- Print ---
+
+/// @brief The output interface of the core, everything is written through `write`.
+class Print {
+
+public:
+
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        for (size_t i = 0; i < size; i++) write(buffer[i]);
+        return size;
+    }
+
+    size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+    size_t print(const char* str) { return write(str); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[256];
+        va_list args;
+        va_start(args, format);
+        const int length = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        return (length > 0) ? write((const uint8_t*)buf, std::min((size_t)length, sizeof(buf) - 1)) : 0;
+    }
+
+};
+
+/// @brief The serial port, everything written is kept in `output` for the tests to check.
+class HostSerial : public Print {
+
+public:
+
+    std::string output;
+    size_t write(uint8_t c) override { output += (char)c; return 1; }
+    using Print::write;
+
+};
+
+inline HostSerial Serial;
+
+
+// --- Time ---
+
+/// @brief Milliseconds since the first call, instead of the start.
+inline uint32_t millis() {
+
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+}
+
+
+// --- Helpers ---
+using std::min;
+using std::max;
+
+#endif /* HOST_ARDUINO_H */
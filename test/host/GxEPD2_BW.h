@@ -0,0 +1,26 @@
+#ifndef HOST_GXEPD2_BW_H
+#define HOST_GXEPD2_BW_H
+
+/*
+    Stand-in for GxEPD2, for the host tests. Only the colors and the size
+    of the panel are needed, as the tests draw on the `VirtualDisplay`.
+*/
+
+// --- Libraries ---
+#include <Adafruit_GFX.h>
+
+
+// --- Colors ---
+#define GxEPD_BLACK 0x0000
+#define GxEPD_WHITE 0xFFFF
+
+
+// --- Panels ---
+
+/// @brief The size of the panel of the clock, without rotation.
+struct GxEPD2_290_BS {
+    static const uint16_t WIDTH = 128;
+    static const uint16_t HEIGHT = 296;
+};
+
+#endif /* HOST_GXEPD2_BW_H */
@@ -0,0 +1,28 @@
+#ifndef HOST_ESP_ROM_CRC_H
+#define HOST_ESP_ROM_CRC_H
+
+/*
+    Stand-in for the CRC function in the ROM of the ESP32, for the host
+    tests. The same CRC32, bit by bit, as speed does not matter here.
+*/
+
+// --- Libraries ---
+#include <stdint.h>
+
+
+// --- Functions ---
+
+/// @brief Calculates the little endian CRC32, like the ROM function.
+/// @param crc The CRC of the data before, 0 at the start.
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (uint8_t i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+
+}
+
+#endif /* HOST_ESP_ROM_CRC_H */
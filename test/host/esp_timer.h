@@ -0,0 +1,23 @@
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+/*
+    Stand-in for the high resolution timer of the ESP32, for the host tests.
+*/
+
+// --- Libraries ---
+#include <stdint.h>
+#include <chrono>
+
+
+// --- Functions ---
+
+/// @brief Microseconds since the first call, instead of the start.
+inline int64_t esp_timer_get_time() {
+
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+}
+
+#endif /* HOST_ESP_TIMER_H */
@@ -0,0 +1,34 @@
+#ifndef HOST_GFXFONT_H
+#define HOST_GFXFONT_H
+
+/*
+    The font structures of Adafruit GFX, for the host tests.
+    The layout has to match, the generated fonts are read by offset.
+*/
+
+// --- Libraries ---
+#include <stdint.h>
+
+
+// --- Fonts ---
+
+/// @brief A character of a font.
+typedef struct {
+    uint16_t bitmapOffset;  // Offset of the bitmap in the bitmap array of the font.
+    uint8_t width;          // Size of the bitmap in pixels.
+    uint8_t height;
+    uint8_t xAdvance;       // Distance to move the cursor by.
+    int8_t xOffset;         // Distance from the cursor to the top left of the bitmap.
+    int8_t yOffset;
+} GFXglyph;
+
+/// @brief A font, with the glyphs of the characters from `first` to `last`.
+typedef struct {
+    uint8_t* bitmap;
+    GFXglyph* glyph;
+    uint16_t first;
+    uint16_t last;
+    uint8_t yAdvance;       // Distance between the lines.
+} GFXfont;
+
+#endif /* HOST_GFXFONT_H */
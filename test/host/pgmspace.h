@@ -0,0 +1,20 @@
+#ifndef HOST_PGMSPACE_H
+#define HOST_PGMSPACE_H
+
+/*
+    Stand-in for the program memory access of the Arduino core, for the
+    host tests. Constants are in the normal memory of the host.
+*/
+
+// --- Libraries ---
+#include <stdint.h>
+
+
+// --- Program Memory ---
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+
+#endif /* HOST_PGMSPACE_H */
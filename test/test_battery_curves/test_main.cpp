@@ -0,0 +1,87 @@
+#include <unity.h>
+
+#include "battery_helper/battery_helper.h"
+
+
+/*
+    Compares the discharge curve to the formula it replaced, for every
+    millivolt the ADC can report. The curve follows the reference chart,
+    so small differences are expected, but not larger than this.
+*/
+#define MAX_DEVIATION_PERCENT 3
+#define SWEEP_MAX_MILLIVOLTS  5000
+
+
+// --- Helper Functions ---
+
+/// @brief The linear and logistic approximation used before the discharge curves.
+static uint8_t oldBatteryPercent(uint32_t battery_voltage) {
+
+    if (battery_voltage >= (4200 - FULL_BATTERY_TOLERANCE)) {
+        return 100;
+    } else if (battery_voltage >= 3870) {
+        return round(120 * ((float)battery_voltage / 1000) - 404);
+    } else if (battery_voltage > 3300) {
+        return round(113 / (1 + exp(46.3 - 12 * ((float)battery_voltage / 1000))));
+    } else {
+        return 0;
+    }
+
+}
+
+
+// --- Tests ---
+
+void setUp() {}
+void tearDown() {}
+
+void test_deviation_from_old_formula() {
+
+    int max_deviation = 0;
+    uint32_t max_deviation_millivolts = 0;
+
+    for (uint32_t millivolts = 0; millivolts <= SWEEP_MAX_MILLIVOLTS; millivolts++) {
+        const int deviation = abs((int)batteryPercent(millivolts) - (int)oldBatteryPercent(millivolts));
+        if (deviation > max_deviation) {
+            max_deviation = deviation;
+            max_deviation_millivolts = millivolts;
+        }
+    }
+
+    char message[64];
+    snprintf(message, sizeof(message), "Largest deviation %d%% at %u mV", max_deviation, (unsigned)max_deviation_millivolts);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_OR_EQUAL_INT_MESSAGE(MAX_DEVIATION_PERCENT, max_deviation, message);
+
+}
+
+void test_percent_does_not_increase_with_falling_voltage() {
+
+    uint8_t last_percent = 100;
+    for (int32_t millivolts = SWEEP_MAX_MILLIVOLTS; millivolts >= 0; millivolts--) {
+        const uint8_t percent = batteryPercent(millivolts);
+        TEST_ASSERT_TRUE_MESSAGE(percent <= last_percent, "The percent increased with a lower voltage");
+        last_percent = percent;
+    }
+
+}
+
+void test_curve_points_are_exact() {
+
+    const size_t count = sizeof(BATTERY_CURVE) / sizeof(BATTERY_CURVE[0]);
+    for (size_t i = 1; i < count; i++) {
+        TEST_ASSERT_EQUAL_UINT8(BATTERY_CURVE[i].percent, batteryPercent(BATTERY_CURVE[i].millivolts));
+    }
+    TEST_ASSERT_EQUAL_UINT8(100, batteryPercent(BATTERY_CURVE[0].millivolts));
+
+}
+
+int main() {
+
+    UNITY_BEGIN();
+    RUN_TEST(test_deviation_from_old_formula);
+    RUN_TEST(test_percent_does_not_increase_with_falling_voltage);
+    RUN_TEST(test_curve_points_are_exact);
+    return UNITY_END();
+
+}
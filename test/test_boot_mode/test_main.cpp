@@ -0,0 +1,156 @@
+#include <unity.h>
+
+#include "boot_mode/boot_mode.h"
+
+
+/*
+    Compares the mode selection to the decision tree it replaced, for
+    every combination of its inputs. The tree works on the raw reset and
+    wakeup causes, and the levels of the buttons, these are reduced to
+    wake sources the same way as `getBootWakes` in `main.cpp` does.
+*/
+
+
+// --- Raw Inputs ---
+enum ResetCause { RESET_POWER_ON, RESET_SOFTWARE, RESET_DEEP_SLEEP, RESET_CAUSE_COUNT };
+enum WakeupCause { WAKEUP_TIMER, WAKEUP_GPIO, WAKEUP_OTHER, WAKEUP_CAUSE_COUNT };
+
+#define PRESSED_OTA    0x01
+#define PRESSED_TOP    0x02
+#define PRESSED_BOTTOM 0x04
+#define PRESSED_COUNT  8
+
+
+// --- Helper Functions ---
+
+/// @brief The decision tree of `setup` before the transition table, after the persistent state is loaded.
+static uint8_t baselineModeSelect(uint8_t reset_cause, uint8_t wakeup_cause, uint8_t pressed,
+    uint8_t desired_mode, uint8_t last_mode, bool charging_started, bool resync_due) {
+
+    uint8_t mode;
+
+    // Check if we have a valid desired mode.
+    if (desired_mode & (NORMAL_MODE + UPDATE_MODE + SECONDS_MODE + STOPPER_MODE + RESET_MODE)) {
+        mode = desired_mode;
+    } else {
+        mode = NULL_MODE;
+    }
+
+    // If we have woken up from deep sleep, investigate the cause.
+    if (reset_cause == RESET_DEEP_SLEEP && mode == NULL_MODE) {
+        if ( wakeup_cause == WAKEUP_TIMER ) { mode = NORMAL_MODE; }
+        else if ( wakeup_cause == WAKEUP_GPIO ) {
+            if      ( (pressed & PRESSED_OTA) && (last_mode != UPDATE_MODE) ) { mode = UPDATE_MODE;  }
+            else if ( pressed & PRESSED_TOP )                                 { mode = SECONDS_MODE; }
+            else if ( pressed & PRESSED_BOTTOM )                              { mode = STOPPER_MODE; }
+        }
+    }
+
+    // If charging has just started, we can use the external power for maintenance.
+    if (charging_started && ((mode == NULL_MODE) || (mode == NORMAL_MODE))) {
+        mode = CHARGING_MODE;
+    }
+
+    // If we are in normal mode, we may need to do a resync.
+    if ((mode == NORMAL_MODE) && resync_due) { mode = RESYNC_MODE; }
+
+    // If we are not in any mode yet, just say we were in a reset.
+    if (mode == NULL_MODE) { mode = RESET_MODE; }
+
+    return mode;
+
+}
+
+/// @brief Reduces the raw causes to wake sources, like `getBootWakes`.
+static uint8_t wakesOf(uint8_t reset_cause, uint8_t wakeup_cause, uint8_t pressed) {
+
+    if (reset_cause == RESET_SOFTWARE) return 1 << WAKE_SOFT_RESET;
+    if (reset_cause != RESET_DEEP_SLEEP) return 1 << WAKE_POWER_ON;
+    if (wakeup_cause == WAKEUP_TIMER) return 1 << WAKE_TIMER;
+    if (wakeup_cause != WAKEUP_GPIO) return 1 << WAKE_UNKNOWN;
+
+    uint8_t wakes = 0;
+    if (pressed & PRESSED_OTA)    wakes |= 1 << WAKE_OTA_BUTTON;
+    if (pressed & PRESSED_TOP)    wakes |= 1 << WAKE_TOP_BUTTON;
+    if (pressed & PRESSED_BOTTOM) wakes |= 1 << WAKE_BOTTOM_BUTTON;
+    return (wakes != 0) ? wakes : (1 << WAKE_UNKNOWN);
+
+}
+
+/// @brief Selects the mode with `bootModeSelect`.
+static uint8_t selectMode(uint8_t wakes, uint8_t desired_mode, uint8_t last_mode, bool charging_started, bool resync_due) {
+
+    BootModeInputs inputs;
+    inputs.wakes = wakes;
+    inputs.desired_mode = desired_mode;
+    inputs.last_mode = last_mode;
+    inputs.charging_started = charging_started;
+    inputs.resync_due = resync_due;
+    return bootModeSelect(inputs);
+
+}
+
+
+// --- Tests ---
+
+void setUp() {}
+void tearDown() {}
+
+void test_matches_baseline_for_every_input() {
+
+    uint32_t cases = 0;
+    char message[160];
+
+    for (uint8_t reset_cause = 0; reset_cause < RESET_CAUSE_COUNT; reset_cause++)
+    for (uint8_t wakeup_cause = 0; wakeup_cause < WAKEUP_CAUSE_COUNT; wakeup_cause++)
+    for (uint8_t pressed = 0; pressed < PRESSED_COUNT; pressed++)
+    for (uint16_t desired_mode = 0; desired_mode <= 0xFF; desired_mode++)
+    for (uint16_t last_mode = 0; last_mode <= 0xFF; last_mode++)
+    for (uint8_t flags = 0; flags < 4; flags++) {
+
+        const bool charging_started = flags & 1;
+        const bool resync_due = flags & 2;
+        const uint8_t expected = baselineModeSelect(reset_cause, wakeup_cause, pressed, desired_mode, last_mode, charging_started, resync_due);
+        const uint8_t actual = selectMode(wakesOf(reset_cause, wakeup_cause, pressed), desired_mode, last_mode, charging_started, resync_due);
+        cases++;
+
+        if (expected != actual) {
+            snprintf(message, sizeof(message), "reset=%u wakeup=%u pressed=0x%02X desired=0x%02X last=0x%02X charging_started=%u resync_due=%u",
+                reset_cause, wakeup_cause, pressed, desired_mode, last_mode, charging_started, resync_due);
+            TEST_ASSERT_EQUAL_HEX8_MESSAGE(expected, actual, message);
+        }
+
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(RESET_CAUSE_COUNT * WAKEUP_CAUSE_COUNT * PRESSED_COUNT * 256 * 256 * 4, cases);
+
+}
+
+void test_update_and_top_button_after_update_mode() {
+
+    // The update button exits update mode, the top button held with it still selects seconds mode.
+    const uint8_t wakes = (1 << WAKE_OTA_BUTTON) | (1 << WAKE_TOP_BUTTON);
+    TEST_ASSERT_EQUAL_HEX8(SECONDS_MODE, selectMode(wakes, NULL_MODE, UPDATE_MODE, false, false));
+    TEST_ASSERT_EQUAL_HEX8(UPDATE_MODE, selectMode(wakes, NULL_MODE, NORMAL_MODE, false, false));
+    TEST_ASSERT_EQUAL_HEX8(RESET_MODE, selectMode(1 << WAKE_OTA_BUTTON, NULL_MODE, UPDATE_MODE, false, false));
+
+}
+
+void test_every_mode_has_phases() {
+
+    for (uint8_t i = 0; i < MODE_COUNT; i++) {
+        TEST_ASSERT_TRUE(bootModePhases(1 << i) != 0);
+    }
+    TEST_ASSERT_EQUAL_UINT16(0, bootModePhases(NULL_MODE));
+
+}
+
+int main() {
+
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_baseline_for_every_input);
+    RUN_TEST(test_update_and_top_button_after_update_mode);
+    RUN_TEST(test_every_mode_has_phases);
+    return UNITY_END();
+
+}
@@ -0,0 +1,283 @@
+#include <unity.h>
+
+#include <time.h>
+
+#include "clock_format/clock_format.h"
+#include "energy_ledger/energy_ledger.h"
+#include "rtc_state/rtc_state.h"
+
+
+/*
+    Compares the texts of the clock face to the `strftime` and `sprintf`
+    calls they replaced, and checks the masks of the changed fields as
+    the clock runs through a day, and over day, month and year ends.
+*/
+#define TEST_DAY        1718668800  // 2024-06-18 00:00:00 UTC
+#define TEST_START      946684800   // 2000-01-01 00:00:00 UTC
+#define TEST_END        4102444800  // 2100-01-01 00:00:00 UTC
+#define SECONDS_PER_DAY 86400
+
+
+// --- Helper Functions ---
+
+/// @brief Fills the time of the clock face from a UTC time, the other values are kept.
+static void setTime(ClockValues& values, time_t now, struct tm& timeinfo) {
+
+    gmtime_r(&now, &timeinfo);
+    values.year = timeinfo.tm_year + 1900;
+    values.month = timeinfo.tm_mon + 1;
+    values.day = timeinfo.tm_mday;
+    values.hour = timeinfo.tm_hour;
+    values.minute = timeinfo.tm_min;
+
+}
+
+/// @brief Checks the texts of the time against `strftime`, like the formatting before `clockFormat`.
+static void checkTimeStrings(const struct tm& timeinfo, const ClockStrings& strings) {
+
+    char expected[16];
+    strftime(expected, sizeof(expected), "%H", &timeinfo);
+    TEST_ASSERT_EQUAL_STRING(expected, strings.hour);
+    strftime(expected, sizeof(expected), "%M", &timeinfo);
+    TEST_ASSERT_EQUAL_STRING(expected, strings.minute);
+    strftime(expected, sizeof(expected), "%F", &timeinfo);
+    TEST_ASSERT_EQUAL_STRING(expected, strings.date);
+
+}
+
+/// @brief A clock face with some status bar values, shown on the display.
+static ClockValues shownValues() {
+
+    ClockValues values;
+    memset(&values, 0, sizeof(values));
+    values.year = 2024;
+    values.month = 6;
+    values.day = 18;
+    values.hour = 12;
+    values.minute = 30;
+    values.battery_percent = 57;
+    values.days_remaining = 120;
+    values.last_sync_hour = 11;
+    values.last_sync_minute = 5;
+
+    ClockStrings strings;
+    rtcStateReset();
+    clockFormat(values, strings);
+    clockShown(values);
+    return values;
+
+}
+
+/// @brief Checks the texts of the stopper against `sprintf`, like the formatting before `clockFormatStopper`.
+static void checkStopper(uint32_t elapsed_ms) {
+
+    const unsigned minutes = elapsed_ms / 60000;
+    const unsigned seconds = (elapsed_ms / 1000) % 60;
+    const unsigned hundredths = (elapsed_ms / 10) % 100;
+    char expected[16], actual[16];
+
+    snprintf(expected, sizeof(expected), "%02u:%02u.%02u", minutes, seconds, hundredths);
+    char* end = clockFormatStopper(actual, elapsed_ms, true);
+    TEST_ASSERT_EQUAL_STRING(expected, actual);
+    TEST_ASSERT_EQUAL_PTR(actual + strlen(expected), end);
+    TEST_ASSERT_TRUE(strlen(actual) < 12);
+
+    snprintf(expected, sizeof(expected), "%02u:%02u", minutes, seconds);
+    end = clockFormatStopper(actual, elapsed_ms, false);
+    TEST_ASSERT_EQUAL_STRING(expected, actual);
+    TEST_ASSERT_EQUAL_PTR(actual + strlen(expected), end);
+
+}
+
+
+// --- Tests ---
+
+void setUp() {}
+void tearDown() {}
+
+void test_digits_match_sprintf() {
+
+    char expected[8], actual[8];
+    for (uint32_t value = 0; value <= 0xFFFF; value++) {
+        for (uint8_t width = 1; width <= 5; width++) {
+            snprintf(expected, sizeof(expected), "%0*u", width, (unsigned)value);
+            char* end = clockFormatDigits(actual, value, width);
+            TEST_ASSERT_EQUAL_STRING(expected, actual);
+            TEST_ASSERT_EQUAL_PTR(actual + strlen(expected), end);
+        }
+    }
+
+    // Wider values, up to the largest.
+    char wide_expected[12], wide_actual[12];
+    for (uint64_t value = 0x10000; value <= 0xFFFFFFFF; value = value * 3 + 1) {
+        snprintf(wide_expected, sizeof(wide_expected), "%02u", (unsigned)value);
+        clockFormatDigits(wide_actual, value, 2);
+        TEST_ASSERT_EQUAL_STRING(wide_expected, wide_actual);
+    }
+    clockFormatDigits(wide_actual, 0xFFFFFFFF, 2);
+    TEST_ASSERT_EQUAL_STRING("4294967295", wide_actual);
+
+}
+
+void test_stopper_matches_sprintf() {
+
+    // Every hundredth of the first two hours, then larger steps, and the longest time.
+    for (uint32_t elapsed_ms = 0; elapsed_ms < 2 * 3600000; elapsed_ms += 10) checkStopper(elapsed_ms);
+    for (uint64_t elapsed_ms = 2 * 3600000; elapsed_ms <= 0xFFFFFFFF; elapsed_ms += 999983) checkStopper(elapsed_ms);
+    checkStopper(0xFFFFFFFF);
+
+}
+
+void test_every_minute_of_a_day() {
+
+    ClockValues values = shownValues();
+    ClockStrings strings;
+    struct tm timeinfo;
+
+    setTime(values, TEST_DAY - 60, timeinfo);
+    clockFormat(values, strings);
+    clockShown(values);
+
+    for (time_t now = TEST_DAY; now < TEST_DAY + SECONDS_PER_DAY; now += 60) {
+
+        setTime(values, now, timeinfo);
+        const uint8_t changed = clockFormat(values, strings);
+        checkTimeStrings(timeinfo, strings);
+
+        // The minute always changes, the hour on the hour, the date only at the start.
+        uint8_t expected = CLOCK_FIELD_MINUTE;
+        if (timeinfo.tm_min == 0) expected |= CLOCK_FIELD_HOUR;
+        if (now == TEST_DAY) expected |= CLOCK_FIELD_DATE;
+        TEST_ASSERT_EQUAL_HEX8(expected, changed);
+
+        // Formatting again, after it is shown, changes nothing.
+        clockShown(values);
+        TEST_ASSERT_EQUAL_HEX8(0, clockFormat(values, strings));
+
+    }
+
+}
+
+void test_day_month_and_year_rollovers() {
+
+    ClockValues values = shownValues();
+    ClockStrings strings;
+    struct tm before, after;
+
+    for (time_t midnight = TEST_START; midnight < TEST_END; midnight += SECONDS_PER_DAY) {
+
+        setTime(values, midnight - 60, before);
+        clockFormat(values, strings);
+        checkTimeStrings(before, strings);
+        clockShown(values);
+
+        setTime(values, midnight, after);
+        const uint8_t changed = clockFormat(values, strings);
+        checkTimeStrings(after, strings);
+        TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_HOUR | CLOCK_FIELD_MINUTE | CLOCK_FIELD_DATE, changed);
+
+    }
+
+}
+
+void test_status_bar_strings() {
+
+    ClockValues values = shownValues();
+    ClockStrings strings;
+    char expected[16];
+
+    for (uint16_t percent = 0; percent <= 100; percent++) {
+        values.battery_percent = percent;
+        clockFormat(values, strings);
+        snprintf(expected, sizeof(expected), "%d%%", percent);
+        TEST_ASSERT_EQUAL_STRING(expected, strings.battery_value);
+    }
+
+    for (uint32_t days = 0; days <= LEDGER_DAYS_UNKNOWN; days++) {
+        values.days_remaining = days;
+        clockFormat(values, strings);
+        if (days == LEDGER_DAYS_UNKNOWN) {
+            snprintf(expected, sizeof(expected), "--d");
+        } else {
+            snprintf(expected, sizeof(expected), "%dd", min((uint16_t)days, (uint16_t)999));
+        }
+        TEST_ASSERT_EQUAL_STRING(expected, strings.days_remaining);
+    }
+
+    for (uint8_t hour = 0; hour < 24; hour++) {
+        for (uint8_t minute = 0; minute < 60; minute++) {
+            values.last_sync_hour = hour;
+            values.last_sync_minute = minute;
+            clockFormat(values, strings);
+            snprintf(expected, sizeof(expected), "%02d", hour);
+            TEST_ASSERT_EQUAL_STRING(expected, strings.last_sync_hour);
+            snprintf(expected, sizeof(expected), "%02d", minute);
+            TEST_ASSERT_EQUAL_STRING(expected, strings.last_sync_minute);
+        }
+    }
+
+}
+
+void test_changed_field_masks() {
+
+    ClockStrings strings;
+    ClockValues values;
+
+    values = shownValues();
+    TEST_ASSERT_EQUAL_HEX8(0, clockFormat(values, strings));
+
+    values = shownValues(); values.hour++;
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_HOUR, clockFormat(values, strings));
+    values = shownValues(); values.minute++;
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_MINUTE, clockFormat(values, strings));
+    values = shownValues(); values.year++;
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_DATE, clockFormat(values, strings));
+    values = shownValues(); values.month++;
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_DATE, clockFormat(values, strings));
+    values = shownValues(); values.day++;
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_DATE, clockFormat(values, strings));
+    values = shownValues(); values.battery_percent++;
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_BATTERY, clockFormat(values, strings));
+    values = shownValues(); values.battery_icon++;
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_BATTERY, clockFormat(values, strings));
+    values = shownValues(); values.days_remaining++;
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_DAYS_REMAINING, clockFormat(values, strings));
+    values = shownValues(); values.days_remaining = LEDGER_DAYS_UNKNOWN;
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_DAYS_REMAINING, clockFormat(values, strings));
+    values = shownValues(); values.last_sync_hour++;
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_LAST_SYNC, clockFormat(values, strings));
+    values = shownValues(); values.last_sync_minute++;
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_LAST_SYNC, clockFormat(values, strings));
+
+    // Every combination of fields is reported as is.
+    values = shownValues(); values.hour++; values.minute++; values.day++; values.battery_percent++; values.days_remaining++; values.last_sync_minute++;
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_ALL, clockFormat(values, strings));
+
+    // Days remaining above what is shown do not change the text.
+    values = shownValues(); values.days_remaining = 1000;
+    clockFormat(values, strings);
+    clockShown(values);
+    values.days_remaining = 1500;
+    TEST_ASSERT_EQUAL_HEX8(0, clockFormat(values, strings));
+
+    // Without a clock face on the display, every field is changed.
+    values = shownValues();
+    clockForget();
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_ALL, clockFormat(values, strings));
+    rtcStateReset();
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_ALL, clockFormat(values, strings));
+
+}
+
+int main() {
+
+    UNITY_BEGIN();
+    RUN_TEST(test_digits_match_sprintf);
+    RUN_TEST(test_stopper_matches_sprintf);
+    RUN_TEST(test_every_minute_of_a_day);
+    RUN_TEST(test_day_month_and_year_rollovers);
+    RUN_TEST(test_status_bar_strings);
+    RUN_TEST(test_changed_field_masks);
+    return UNITY_END();
+
+}
@@ -0,0 +1,127 @@
+#include <unity.h>
+
+#include <esp_timer.h>
+
+#include "display_helper/display_helper.h"
+#include "mode_switch/mode_switch.h"
+#include "rtc_state/rtc_state.h"
+
+
+/*
+    Requests modes the way the button interrupts do while the clock is
+    awake, and checks that the requested mode is switched to, and its first
+    frame is refreshed on the virtual display, without a restart in between.
+    The latency from the request to the end of the refresh is the part of
+    the firmware, on the clock the release of the button and the panel add
+    to it. It is printed, and has to stay well below what a user notices.
+*/
+#define MAX_LATENCY_US 100000
+
+
+// --- Globals ---
+extern VirtualDisplay display;
+
+
+// --- Helper Functions ---
+
+/// @brief Draws the first frame of the current mode, as `runMode` in `setup` does.
+static void refreshMode() {
+
+    const uint16_t phases = bootModePhases(rtc_state.mode);
+    displayStartDraw(/*fast=*/ true);
+
+    if (phases & PHASE_UPDATE) {
+        displayRenderUpdateMessage();
+    } else if (phases & PHASE_STOPPER) {
+        displayRenderFlag((char*)"STOPPER");
+        displayRenderStopper(0, /*precise=*/ true);
+        displayRenderStopperLast(rtc_state.stopper_elapsed);
+    } else {
+        displayRenderTime((char*)"12", (char*)"34");
+        if (phases & PHASE_SECONDS) displayRenderSecond(56);
+    }
+
+    displayEndDraw();
+
+}
+
+/// @brief Switches to a requested mode, and checks the switch and its refresh.
+/// @param mode The mode requested.
+static void checkSwitch(uint8_t mode) {
+
+    char message[96];
+    const uint8_t from_mode = rtc_state.mode;
+    const uint32_t refreshes = display.full_refreshes + display.partial_refreshes;
+
+    modeSwitchRequest(mode);
+    TEST_ASSERT_EQUAL_HEX8(mode, modeSwitchPending());
+
+    TEST_ASSERT_EQUAL_HEX8(from_mode, modeSwitchTake());
+    TEST_ASSERT_EQUAL_HEX8(mode, rtc_state.mode);
+    TEST_ASSERT_EQUAL_HEX8(NULL_MODE, modeSwitchPending());
+
+    refreshMode();
+    const int64_t latency_us = esp_timer_get_time() - modeSwitchRequestTime();
+    TEST_ASSERT_EQUAL_UINT32(refreshes + 1, display.full_refreshes + display.partial_refreshes);
+
+    printf("Mode latency: mode=%u to_refresh=%u us\n", mode, (unsigned)latency_us);
+    snprintf(message, sizeof(message), "Switching to mode %u took %u us", mode, (unsigned)latency_us);
+    TEST_ASSERT_TRUE_MESSAGE(latency_us <= MAX_LATENCY_US, message);
+
+}
+
+
+// --- Tests ---
+
+void setUp() {
+
+    // Every test starts awake in normal mode, with the clock face drawn.
+    rtcStateLoad(false);
+    rtc_state.mode = NORMAL_MODE;
+    displayInit(true);
+    refreshMode();
+    Serial.output.clear();
+
+}
+
+void tearDown() {}
+
+void test_no_request() {
+
+    TEST_ASSERT_EQUAL_HEX8(NULL_MODE, modeSwitchPending());
+
+}
+
+void test_button_modes_without_restart() {
+
+    // The buttons of normal mode, and the ones leaving the modes.
+    checkSwitch(SECONDS_MODE);
+    checkSwitch(NORMAL_MODE);
+    checkSwitch(STOPPER_MODE);
+    checkSwitch(NORMAL_MODE);
+    checkSwitch(UPDATE_MODE);
+    checkSwitch(NORMAL_MODE);
+
+}
+
+void test_last_request_wins() {
+
+    modeSwitchRequest(SECONDS_MODE);
+    const int64_t later_us = esp_timer_get_time();
+    modeSwitchRequest(STOPPER_MODE);
+
+    TEST_ASSERT_EQUAL_HEX8(NORMAL_MODE, modeSwitchTake());
+    TEST_ASSERT_EQUAL_HEX8(STOPPER_MODE, rtc_state.mode);
+    TEST_ASSERT_TRUE(modeSwitchRequestTime() >= later_us);
+
+}
+
+int main() {
+
+    UNITY_BEGIN();
+    RUN_TEST(test_no_request);
+    RUN_TEST(test_button_modes_without_restart);
+    RUN_TEST(test_last_request_wins);
+    return UNITY_END();
+
+}
@@ -0,0 +1,114 @@
+#include <unity.h>
+
+#include <string>
+
+#include "display_helper/display_helper.h"
+#include "render_benchmark/render_benchmark.h"
+
+
+/*
+    Runs the render benchmark on the host, and compares each case to an
+    earlier run in `baseline.txt`, where a line has the name of the case,
+    its pixels written per frame, and its time per frame in percent of the
+    first case, the reference. The pixel count is the same on the host and
+    the clock, the time relative to the reference changes little between
+    computers, so a font or layout change that makes rendering much slower
+    fails here. The benchmark is run a few times, and the fastest time of
+    each case is used, as the others are slowed down by the computer.
+
+    Every case has to be in the baseline, for a missing one the test fails
+    with the lines to add. If a case changes on purpose, update its line.
+*/
+#define BASELINE_PATH       "test/test_render_benchmark/baseline.txt"
+#define MAX_GROWTH_PERCENT  50  // Well below the doubling that has to be noticed.
+#define MAX_TIME_FACTOR     2   // The time varies more, between computers and compilers.
+#define MIN_TIME_PERCENT    10  // Cases much faster than the reference are only timer noise.
+#define BENCHMARK_RUNS      5
+
+
+// --- Helper Functions ---
+
+/// @brief Finds a case in the baseline.
+/// @param pixels Pixels written per frame.
+/// @param time_percent Time per frame, in percent of the reference.
+/// @return False if the case is not in it.
+static bool baselineCase(const char* name, uint32_t& pixels, uint32_t& time_percent) {
+
+    FILE* file = fopen(BASELINE_PATH, "r");
+    if (file == NULL) return false;
+
+    char line[64];
+    char line_name[32];
+    unsigned line_pixels, line_percent;
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), file)) {
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%31s %u %u", line_name, &line_pixels, &line_percent) != 3) continue;
+        if (strcmp(line_name, name) != 0) continue;
+        pixels = line_pixels;
+        time_percent = line_percent;
+        found = true;
+    }
+    fclose(file);
+    return found;
+
+}
+
+
+// --- Tests ---
+
+void setUp() {}
+void tearDown() {}
+
+void test_within_baseline() {
+
+    RenderBenchmarkResult results[RENDER_BENCHMARK_CASES];
+    uint32_t fastest_ns[RENDER_BENCHMARK_CASES];
+    char message[160];
+    std::string missing;
+
+    displayInit(true);
+    for (uint8_t run = 0; run < BENCHMARK_RUNS; run++) {
+        Serial.output.clear();
+        TEST_ASSERT_EQUAL_UINT8(RENDER_BENCHMARK_CASES, renderBenchmarkRun(results));
+        for (uint8_t i = 0; i < RENDER_BENCHMARK_CASES; i++) {
+            if ((run == 0) || (results[i].ns_per_frame < fastest_ns[i])) fastest_ns[i] = results[i].ns_per_frame;
+        }
+    }
+    printf("%s", Serial.output.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(fastest_ns[0] > 0, "The reference case is too fast to time");
+
+    for (uint8_t i = 0; i < RENDER_BENCHMARK_CASES; i++) {
+
+        const uint32_t time_percent = (uint64_t)fastest_ns[i] * 100 / fastest_ns[0];
+        uint32_t baseline_pixels, baseline_percent;
+        if (!baselineCase(results[i].name, baseline_pixels, baseline_percent)) {
+            snprintf(message, sizeof(message), "%s %u %u\n", results[i].name, (unsigned)results[i].pixels_per_frame, (unsigned)time_percent);
+            missing += message;
+            continue;
+        }
+
+        snprintf(message, sizeof(message), "%s writes %u pixels per frame, %u in the baseline",
+            results[i].name, (unsigned)results[i].pixels_per_frame, (unsigned)baseline_pixels);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(baseline_pixels * (100 + MAX_GROWTH_PERCENT) / 100, results[i].pixels_per_frame, message);
+
+        snprintf(message, sizeof(message), "%s takes %u%% of the reference time per frame, %u%% in the baseline",
+            results[i].name, (unsigned)time_percent, (unsigned)baseline_percent);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(max(baseline_percent, (uint32_t)MIN_TIME_PERCENT) * MAX_TIME_FACTOR, time_percent, message);
+
+    }
+
+    if (!missing.empty()) {
+        printf("Cases missing from %s, check and add them:\n%s", BASELINE_PATH, missing.c_str());
+        TEST_FAIL_MESSAGE("Cases are missing from the baseline, see the lines printed above");
+    }
+
+}
+
+int main() {
+
+    UNITY_BEGIN();
+    RUN_TEST(test_within_baseline);
+    return UNITY_END();
+
+}
@@ -0,0 +1,197 @@
+#include <unity.h>
+
+#include <time.h>
+
+#include "settings.h"
+#include "rtc_state/rtc_state.h"
+
+
+/*
+    Compares the local time to `localtime_r` of the C library, around
+    every DST transition of the TZ strings below, from 2000 to 2100.
+    Each string uses a different form the parser supports, see
+    `time_zone.h`. The conversion always uses `TIMEZONE`, so the source
+    is included here, with `TIMEZONE` pointing to the string under test.
+*/
+static const char* const settings_zone = TIMEZONE;
+static const char* test_zone = TIMEZONE;
+
+#undef TIMEZONE
+#define TIMEZONE test_zone
+#include "time_zone/time_zone.cpp"
+
+static const char* const test_zones[] = {
+    settings_zone,
+    "EST5EDT,M3.2.0,M11.1.0",           // Western hemisphere.
+    "AEST-10AEDT,M10.1.0,M4.1.0/3",     // Southern hemisphere, DST over the new year.
+    "NZST-12NZDT,M9.5.0,M4.1.0/3",      // Last week of a month with 30 days.
+    "IST-1GMT0,M10.5.0,M3.5.0/1",       // DST behind the standard time.
+    "<-03>3<-02>,M3.5.0/-2,M10.5.0/-1", // Quoted names, negative transition times.
+    "XXX-2YYY,J60/0,300/25",            // Julian and plain day numbers, a time past midnight.
+    "<+0330>-3:30",                     // No DST, an offset with minutes.
+    "UTC0",
+};
+
+#define TEST_START      946684800   // 2000-01-01 00:00:00 UTC
+#define TEST_END        4102444800  // 2100-01-01 00:00:00 UTC
+#define SCAN_STEP       3600        // Transitions are further apart than this.
+#define SAMPLE_STEP     25213       // Seconds between the plain samples, to hit every time of the day.
+
+/// @brief The offsets around a transition to check, in seconds.
+static const int32_t transition_offsets[] = { -3601, -3600, -61, -1, 0, 1, 59, 3599, 3600 };
+
+
+// --- Helper Functions ---
+
+/// @brief Selects the zone for both `localtime_r` and `timeZoneLocal`, and clears the persistent state.
+static void selectZone(const char* zone) {
+
+    test_zone = zone;
+    setenv("TZ", zone, 1);
+    tzset();
+    rtcStateReset();
+
+}
+
+/// @brief Compares the local time of a moment, with the state left by the previous call.
+/// @return False on a mismatch, after failing the test with a message.
+static bool checkTime(const char* zone, time_t now) {
+
+    struct tm expected, actual;
+    localtime_r(&now, &expected);
+    timeZoneLocal(now, &actual);
+
+    if (expected.tm_sec == actual.tm_sec && expected.tm_min == actual.tm_min && expected.tm_hour == actual.tm_hour &&
+        expected.tm_mday == actual.tm_mday && expected.tm_mon == actual.tm_mon && expected.tm_year == actual.tm_year &&
+        expected.tm_wday == actual.tm_wday && expected.tm_yday == actual.tm_yday) return true;
+
+    char message[160];
+    snprintf(message, sizeof(message), "%s at %lld: expected %04d-%02d-%02d %02d:%02d:%02d, got %04d-%02d-%02d %02d:%02d:%02d",
+        zone, (long long)now,
+        expected.tm_year + 1900, expected.tm_mon + 1, expected.tm_mday, expected.tm_hour, expected.tm_min, expected.tm_sec,
+        actual.tm_year + 1900, actual.tm_mon + 1, actual.tm_mday, actual.tm_hour, actual.tm_min, actual.tm_sec);
+    TEST_FAIL_MESSAGE(message);
+    return false;
+
+}
+
+/// @brief Finds the transitions of the current zone with `localtime_r`.
+/// @return The number of transitions found, at most `capacity`.
+static size_t findTransitions(time_t* transitions, size_t capacity) {
+
+    size_t count = 0;
+    struct tm before, after;
+    for (time_t t = TEST_START; (t < TEST_END) && (count < capacity); t += SCAN_STEP) {
+
+        const time_t next = t + SCAN_STEP;
+        localtime_r(&t, &before);
+        localtime_r(&next, &after);
+        if (before.tm_gmtoff == after.tm_gmtoff) continue;
+
+        // The first second of the new offset.
+        time_t low = t, high = next;
+        while (high - low > 1) {
+            const time_t middle = low + (high - low) / 2;
+            localtime_r(&middle, &after);
+            if (after.tm_gmtoff == before.tm_gmtoff) low = middle; else high = middle;
+        }
+        transitions[count++] = high;
+
+    }
+    return count;
+
+}
+
+
+// --- Tests ---
+
+void setUp() {}
+void tearDown() {}
+
+void test_settings_zone_parses() {
+
+    TimeZoneSpec spec;
+    TEST_ASSERT_TRUE(timeZoneParse(settings_zone, spec));
+    TEST_ASSERT_FALSE(timeZoneParse("", spec));
+    TEST_ASSERT_FALSE(timeZoneParse("CET-1CEST,M3.5.0", spec));
+    TEST_ASSERT_FALSE(timeZoneParse("CET-1CEST,M13.5.0,M10.5.0/3", spec));
+
+}
+
+void test_transitions_in_order() {
+
+    // Like on the device, the state follows the time forward.
+    static time_t transitions[256];
+    for (const char* zone : test_zones) {
+        selectZone(zone);
+        const size_t count = findTransitions(transitions, 256);
+
+        // Two transitions a year, or none.
+        TimeZoneSpec spec;
+        timeZoneParse(zone, spec);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(spec.has_dst ? 200 : 0, count, zone);
+
+        for (size_t i = 0; i < count; i++) {
+            for (int32_t offset : transition_offsets) {
+                if (!checkTime(zone, transitions[i] + offset)) return;
+            }
+        }
+    }
+
+}
+
+void test_transitions_in_reverse() {
+
+    // A sync can move the clock back across a transition.
+    static time_t transitions[256];
+    for (const char* zone : test_zones) {
+        selectZone(zone);
+        const size_t count = findTransitions(transitions, 256);
+        for (size_t i = count; i-- > 0;) {
+            for (int32_t offset : transition_offsets) {
+                if (!checkTime(zone, transitions[i] - offset)) return;
+            }
+        }
+    }
+
+}
+
+void test_transitions_after_reset() {
+
+    // After a reset, the state is calculated from nothing.
+    static time_t transitions[256];
+    for (const char* zone : test_zones) {
+        selectZone(zone);
+        const size_t count = findTransitions(transitions, 256);
+        for (size_t i = 0; i < count; i++) {
+            for (int32_t offset : transition_offsets) {
+                rtcStateReset();
+                if (!checkTime(zone, transitions[i] + offset)) return;
+            }
+        }
+    }
+
+}
+
+void test_samples_between_transitions() {
+
+    for (const char* zone : test_zones) {
+        selectZone(zone);
+        for (time_t t = TEST_START; t < TEST_END; t += SAMPLE_STEP) {
+            if (!checkTime(zone, t)) return;
+        }
+    }
+
+}
+
+int main() {
+
+    UNITY_BEGIN();
+    RUN_TEST(test_settings_zone_parses);
+    RUN_TEST(test_transitions_in_order);
+    RUN_TEST(test_transitions_in_reverse);
+    RUN_TEST(test_transitions_after_reset);
+    RUN_TEST(test_samples_between_transitions);
+    return UNITY_END();
+
+}
@@ -0,0 +1,167 @@
+#include <unity.h>
+
+#include <filesystem>
+
+#include "display_helper/display_helper.h"
+
+
+/*
+    Renders parts of the clock face on the virtual display, and compares
+    the captured images to the golden ones in `golden/`. The header of an
+    image describes the refresh, so the kind, the window and the SPI size
+    are compared too.
+
+    If a golden image differs or is missing, the test fails, and the render
+    is written to the temporary directory with an `.actual.pbm` extension,
+    the message has the path. Open both in an image viewer to see the
+    change, and if it is wanted, copy the render to `golden/` and commit
+    it. The tests never write into the source tree. The texts in the fonts
+    of Adafruit GFX need the library installed, as their subsets are
+    generated from it, record their images from such a run.
+*/
+#define GOLDEN_DIR "test/test_virtual_display/golden/"
+
+
+// --- Globals ---
+extern VirtualDisplay display;
+
+
+// --- Helper Functions ---
+
+/// @brief Reads a whole file.
+/// @return False if it can not be opened.
+static bool readFile(const char* path, std::string& data) {
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return false;
+    char buf[1024];
+    size_t length;
+    data.clear();
+    while ((length = fread(buf, 1, sizeof(buf), file)) > 0) data.append(buf, length);
+    fclose(file);
+    return true;
+
+}
+
+/// @brief Writes a whole file.
+static void writeFile(const char* path, const std::string& data) {
+
+    FILE* file = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, path);
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+
+}
+
+/// @brief Compares the image of the last refresh to a golden image.
+/// @param name Name of the golden image, without the extension.
+static void checkGolden(const char* name) {
+
+    char path[128];
+    char message[320];
+    std::string golden;
+    const std::string& actual = Serial.output;
+
+    snprintf(path, sizeof(path), GOLDEN_DIR "%s.pbm", name);
+    const bool found = readFile(path, golden);
+    if (found && (actual == golden)) return;
+
+    const std::string actual_path = (std::filesystem::temp_directory_path() / name).string() + ".actual.pbm";
+    writeFile(actual_path.c_str(), actual);
+    snprintf(message, sizeof(message), "%s %s, the render is in %s",
+        found ? "The image differs from" : "There is no golden image", path, actual_path.c_str());
+    TEST_FAIL_MESSAGE(message);
+
+}
+
+
+// --- Tests ---
+
+void setUp() {
+
+    // Every test starts from a blank panel.
+    displayInit(true);
+    Serial.output.clear();
+
+}
+
+void tearDown() {}
+
+void test_time() {
+
+    displayStartDraw();
+    displayRenderTime((char*)"12", (char*)"34");
+    displayEndDraw();
+    checkGolden("time");
+
+}
+
+void test_time_minute_window() {
+
+    displayStartDraw(false, false);
+    const uint8_t fields = displaySetClockWindow(CLOCK_FIELD_MINUTE);
+    TEST_ASSERT_EQUAL_HEX8(CLOCK_FIELD_MINUTE, fields);
+    displayRenderTime((char*)"12", (char*)"59", fields);
+    displayEndDraw();
+    checkGolden("time_minute_window");
+
+}
+
+void test_status_bar() {
+
+    displayStartDraw(true);
+    displayRenderStatusBar((char*)"100%", (char*)"999d", (char*)"09", (char*)"41", 4);
+    displayEndDraw();
+    checkGolden("status_bar");
+
+}
+
+void test_update_message() {
+
+    displayStartDraw();
+    displayRenderUpdateMessage();
+    displayEndDraw();
+    checkGolden("update_message");
+
+}
+
+void test_critical_message() {
+
+    displayStartDraw();
+    displayRenderCriticalMessage();
+    displayEndDraw();
+    checkGolden("critical_message");
+
+}
+
+void test_refresh_counters() {
+
+    const uint32_t full_refreshes = display.full_refreshes;
+    const uint32_t partial_refreshes = display.partial_refreshes;
+    const uint32_t spi_bytes = display.spi_bytes;
+
+    // A fast refresh of the whole panel is partial, but sends every byte.
+    displayStartDraw(true);
+    displayEndDraw();
+    TEST_ASSERT_EQUAL_UINT32(full_refreshes, display.full_refreshes);
+    TEST_ASSERT_EQUAL_UINT32(partial_refreshes + 1, display.partial_refreshes);
+    TEST_ASSERT_EQUAL_UINT32(spi_bytes + 2 * GxEPD2_290_BS::WIDTH / 8 * GxEPD2_290_BS::HEIGHT, display.spi_bytes);
+
+    displayStartDraw();
+    displayEndDraw();
+    TEST_ASSERT_EQUAL_UINT32(full_refreshes + 1, display.full_refreshes);
+
+}
+
+int main() {
+
+    UNITY_BEGIN();
+    RUN_TEST(test_time);
+    RUN_TEST(test_time_minute_window);
+    RUN_TEST(test_status_bar);
+    RUN_TEST(test_update_message);
+    RUN_TEST(test_critical_message);
+    RUN_TEST(test_refresh_counters);
+    return UNITY_END();
+
+}